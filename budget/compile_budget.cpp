@@ -0,0 +1,215 @@
+// Compile representative translation units of the featurless headers several
+// times, then compare the median compile time, the object size and the number
+// of included headers to the limits of a budget file. Returns 1 if a limit is
+// exceeded, 2 on usage or compilation error.
+//
+// Usage:
+// compile_budget --compiler c++ --flags "-std=c++20 -O0 -I..." --units dir
+//                --budget budget.txt --out dir [--runs 5]
+//
+// The budget file has one unit per line, '#' starts a comment:
+// # unit           max_ms   max_object_bytes   max_headers
+// hello_world      800      20000              120
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct Options {
+    std::string compiler;
+    std::string flags;
+    fs::path units;
+    fs::path budget;
+    fs::path out;
+    int runs{ 5 };
+};
+
+struct Limits {
+    std::string unit;
+    double max_ms;
+    std::uintmax_t max_object_bytes;
+    std::size_t max_headers;
+};
+
+struct Result {
+    std::string unit;
+    double ms;
+    std::uintmax_t object_bytes;
+    std::size_t headers;
+};
+
+static std::string quote(const fs::path& path) {
+    return '"' + path.string() + '"';
+}
+
+static bool parse_options(int argc, const char** argv, Options& options) {
+    for (int i = 1; i + 1 < argc; i += 2) {
+        const std::string_view arg{ argv[i] };
+        const char* const value = argv[i + 1];
+        if (arg == "--compiler")
+            options.compiler = value;
+        else if (arg == "--flags")
+            options.flags = value;
+        else if (arg == "--units")
+            options.units = value;
+        else if (arg == "--budget")
+            options.budget = value;
+        else if (arg == "--out")
+            options.out = value;
+        else if (arg == "--runs")
+            options.runs = std::max(1, std::atoi(value));
+        else
+            return false;
+    }
+    return !options.compiler.empty() && !options.units.empty() && !options.budget.empty()
+           && !options.out.empty();
+}
+
+// the biggest units are generated rather than checked in
+static void generate_units(const fs::path& directory) {
+    std::ofstream groups{ directory / "groups_100.cpp" };
+    groups << "#include <featurless/test.h>\n\n";
+    for (int i = 0; i < 100; ++i) {
+        groups << "FEATURLESS_TEST(\"group" << i << "\", \"test\")\n{\n"
+               << "    tester.check(\"group" << i << "\", \"bool\", " << i << " > 0);\n"
+               << "    tester.check(\"group" << i << "\", \"lambda\", []() { return " << i
+               << " % 2 == 0; });\n}\n\n";
+    }
+    groups << "int main(int argc, const char** argv)\n{\n"
+              "    featurless::test tester;\n"
+              "    tester.parse_args(argc, argv);\n"
+              "    tester.run();\n"
+              "    tester.print_summary();\n"
+              "    return tester.status();\n}\n";
+
+    std::ofstream checks{ directory / "checks_10k.cpp" };
+    checks << "#include <featurless/test.h>\n\n"
+              "int main(int argc, const char** argv)\n{\n"
+              "    featurless::test tester;\n"
+              "    tester.parse_args(argc, argv);\n"
+              "    const auto group = tester.add_group(\"checks\");\n"
+              "    int value = argc;\n";
+    for (int i = 0; i < 10000; ++i) {
+        if (i % 10 == 0)
+            checks << "    tester.check(group, \"lambda " << i
+                   << "\", [&value]() { return value != " << i << "; });\n";
+        else
+            checks << "    tester.check(group, \"bool " << i << "\", value + " << i << " > 0);\n";
+    }
+    checks << "    tester.print_summary();\n"
+              "    return tester.status();\n}\n";
+}
+
+static bool read_budget(const fs::path& path, std::vector<Limits>& budget) {
+    std::ifstream file{ path };
+    if (!file)
+        return false;
+    std::string line;
+    while (std::getline(file, line)) {
+        line = line.substr(0, line.find('#'));
+        std::istringstream fields{ line };
+        Limits limits;
+        if (fields >> limits.unit >> limits.max_ms >> limits.max_object_bytes >> limits.max_headers)
+            budget.push_back(limits);
+    }
+    return true;
+}
+
+// -H prints one line per included header, starting with dots (its depth)
+static std::size_t count_headers(const fs::path& trace) {
+    std::ifstream file{ trace };
+    std::string line;
+    std::size_t count = 0;
+    while (std::getline(file, line)) {
+        if (!line.empty() && line.front() == '.')
+            ++count;
+    }
+    return count;
+}
+
+static bool measure(const Options& options, const fs::path& source, Result& result) {
+    const fs::path object = options.out / (result.unit + ".o");
+    const fs::path headers = options.out / (result.unit + ".headers");
+    const std::string compile =
+      options.compiler + ' ' + options.flags + " -c " + quote(source) + " -o " + quote(object);
+
+    std::vector<double> times;
+    for (int run = 0; run < options.runs; ++run) {
+        const auto start = std::chrono::steady_clock::now();
+        if (std::system(compile.c_str()) != 0)
+            return false;
+        const auto elapsed = std::chrono::steady_clock::now() - start;
+        times.push_back(std::chrono::duration<double, std::milli>(elapsed).count());
+    }
+    std::sort(times.begin(), times.end());
+    result.ms = times[times.size() / 2];
+    result.object_bytes = fs::file_size(object);
+
+    const std::string list_headers = options.compiler + ' ' + options.flags + " -H -fsyntax-only "
+                                     + quote(source) + " 2> " + quote(headers);
+    if (std::system(list_headers.c_str()) != 0)
+        return false;
+    result.headers = count_headers(headers);
+    return true;
+}
+
+int main(int argc, const char** argv) {
+    Options options;
+    if (!parse_options(argc, argv, options)) {
+        std::cerr << "usage: compile_budget --compiler c++ --flags \"...\" --units dir "
+                     "--budget budget.txt --out dir [--runs 5]\n";
+        return 2;
+    }
+    std::vector<Limits> budget;
+    if (!read_budget(options.budget, budget)) {
+        std::cerr << "compile_budget: can not read the budget file " << options.budget << '\n';
+        return 2;
+    }
+    fs::create_directories(options.out);
+    generate_units(options.out);
+
+    bool exceeded = false;
+    std::cout << std::left << std::setw(16) << "unit" << std::right << std::setw(18)
+              << "time (ms)" << std::setw(26) << "object (bytes)" << std::setw(16) << "headers"
+              << '\n'
+              << std::fixed << std::setprecision(1);
+    for (const Limits& limits : budget) {
+        fs::path source = options.units / (limits.unit + ".cpp");
+        if (!fs::exists(source))
+            source = options.out / (limits.unit + ".cpp");
+        Result result{ limits.unit, 0, 0, 0 };
+        if (!measure(options, source, result)) {
+            std::cerr << "compile_budget: failed to compile " << source << '\n';
+            return 2;
+        }
+
+        const bool over_time = result.ms > limits.max_ms;
+        const bool over_size = result.object_bytes > limits.max_object_bytes;
+        const bool over_headers = result.headers > limits.max_headers;
+        exceeded = exceeded || over_time || over_size || over_headers;
+        std::ostringstream time;
+        std::ostringstream size;
+        std::ostringstream headers;
+        time << std::fixed << std::setprecision(1) << result.ms << " / " << limits.max_ms
+             << (over_time ? " !" : "  ");
+        size << result.object_bytes << " / " << limits.max_object_bytes
+             << (over_size ? " !" : "  ");
+        headers << result.headers << " / " << limits.max_headers << (over_headers ? " !" : "  ");
+        std::cout << std::left << std::setw(16) << result.unit << std::right << std::setw(18)
+                  << time.str() << std::setw(26) << size.str() << std::setw(16) << headers.str()
+                  << '\n';
+    }
+
+    if (exceeded)
+        std::cout << "compile_budget: budget exceeded (marked with !).\n";
+    return exceeded ? 1 : 0;
+}
@@ -0,0 +1,13 @@
+#include <featurless/test.h>
+
+int main(int argc, const char** argv)
+{
+    featurless::test tester;
+    tester.parse_args(argc, argv);
+
+    tester.add_group("hello");
+    tester.check("hello", "world", true);
+
+    tester.print_summary();
+    return tester.status();
+}
@@ -0,0 +1,37 @@
+#define FEATURLESS_LOG_MIN_LEVEL FEATURLESS_LOG_LEVEL_TRACE
+#include <featurless/log.h>
+
+#define FLOG_ALL(message) \
+    FLOG_TRACE(message);  \
+    FLOG_DEBUG(message);  \
+    FLOG_INFO(message);   \
+    FLOG_WARN(message);   \
+    FLOG_ERROR(message);  \
+    FLOG_FATAL(message)
+
+#define FLOG_ALL_10(message) \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message);       \
+    FLOG_ALL(message)
+
+void log_everything(std::string_view message)
+{
+    FLOG_ALL_10("a literal message");
+    FLOG_ALL_10(message);
+    FLOG_ALL_10(message.substr(1));
+    FLOG_ALL_10("another literal message");
+    FLOG_ALL_10(message.substr(0, 4));
+}
+
+int main()
+{
+    featurless::log::init("budget.log", 1000, 2);
+    log_everything("a view on a message");
+}
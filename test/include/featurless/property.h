@@ -0,0 +1,323 @@
+//===-- property.h --------------------------------------------------------===//
+//                       PROPERTY TESTS FOR TEST.H
+//
+// Check that a predicate holds for thousands of generated inputs. Cases are
+// spread over all the cores, a failing case is shrunk to a minimal
+// counterexample which is printed with the seed reproducing it (--seed).
+// Kept out of test.h, so that only the files using it pay for its includes.
+//
+// The predicate is called concurrently, it must be thread-safe.
+//
+// Code:
+// #include <featurless/property.h>
+// namespace gen = featurless::gen;
+//
+// tester.check_property("parse", "round trip", gen::integer<uint16_t>(),
+//                       gen::string(16), [](uint16_t days, const std::string& name) {
+//                           return parse(format(days, name)) == days;
+//                       });
+//
+// Generators:
+// - gen::integer<T>(min, max): integers of [min, max], the whole type by
+//   default. Bounds and zero are generated more often.
+// - gen::string(max_size): printable ASCII strings.
+// - gen::vector(element, max_size): vectors of values of another generator.
+//
+//===----------------------------------------------------------------------===//
+#ifndef FEATURLESS_PROPERTY_HEADER_GUARD
+#define FEATURLESS_PROPERTY_HEADER_GUARD
+
+#include <featurless/test.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <limits>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace featurless {
+// A failing case can be generated again from its seed alone.
+class test::property_runner {
+public:
+    virtual ~property_runner() = default;
+    // generate the case of a seed and evaluate it, called concurrently.
+    virtual bool run(std::uint64_t seed) = 0;
+    // shrink the failing case of a seed, return a description of the smallest
+    // failing case found.
+    virtual std::string shrink(std::uint64_t seed) = 0;
+};
+
+namespace gen {
+    // splitmix64, small state and fast enough to generate millions of cases.
+    class rng {
+        std::uint64_t _state;
+
+    public:
+        explicit rng(std::uint64_t seed) noexcept
+            : _state{ seed } {}
+
+        std::uint64_t next() noexcept {
+            std::uint64_t z = (_state += 0x9e3779b97f4a7c15ULL);
+            z = (z ^ (z >> 30U)) * 0xbf58476d1ce4e5b9ULL;
+            z = (z ^ (z >> 27U)) * 0x94d049bb133111ebULL;
+            return z ^ (z >> 31U);
+        }
+
+        // uniform in [0, bound], the modulo bias is negligible here
+        std::uint64_t up_to(std::uint64_t bound) noexcept {
+            return bound == std::numeric_limits<std::uint64_t>::max() ? next()
+                                                                       : next() % (bound + 1);
+        }
+    };
+
+    template<typename T>
+    class integer {
+        T _min;
+        T _max;
+
+    public:
+        using value_type = T;
+
+        explicit integer(T min = std::numeric_limits<T>::min(),
+                         T max = std::numeric_limits<T>::max()) noexcept
+            : _min{ min }
+            , _max{ max } {}
+
+        T operator()(rng& random) const noexcept {
+            // one case out of 8 is an edge: bounds, zero and their neighbours
+            if (random.up_to(7) == 0) {
+                const T edges[]{ _min, _max, target(),
+                             static_cast<T>(_min < _max ? _min + 1 : _min),
+                             static_cast<T>(_min < _max ? _max - 1 : _max) };
+                return edges[random.up_to(4)];
+            }
+            const auto range = static_cast<std::uint64_t>(_max) - static_cast<std::uint64_t>(_min);
+            return static_cast<T>(static_cast<std::uint64_t>(_min) + random.up_to(range));
+        }
+
+        // the value the shrinking moves toward: zero if in the bounds
+        T target() const noexcept {
+            if (_min > 0)
+                return _min;
+            if (_max < 0)
+                return _max;
+            return 0;
+        }
+
+        // candidates closer to the target, the closest first
+        std::vector<T> shrink(T value) const {
+            std::vector<T> candidates;
+            const T goal = target();
+            if (value == goal)
+                return candidates;
+            candidates.push_back(goal);
+            // halve the distance to the goal, without overflowing
+            for (T distance = value > goal ? static_cast<T>(value / 2 - goal / 2)
+                                           : static_cast<T>(goal / 2 - value / 2);
+                 distance != 0; distance = static_cast<T>(distance / 2)) {
+                candidates.push_back(
+                  static_cast<T>(value > goal ? value - distance : value + distance));
+            }
+            return candidates;
+        }
+    };
+
+    class string {
+        std::size_t _max_size;
+
+    public:
+        using value_type = std::string;
+
+        explicit string(std::size_t max_size = 32) noexcept
+            : _max_size{ max_size } {}
+
+        std::string operator()(rng& random) const {
+            const std::size_t size = random.up_to(7) == 0 ? _max_size * random.up_to(1)
+                                                          : random.up_to(_max_size);
+            std::string value(size, ' ');
+            for (char& c : value)
+                c = static_cast<char>(' ' + random.up_to('~' - ' '));
+            return value;
+        }
+
+        std::vector<std::string> shrink(const std::string& value) const {
+            std::vector<std::string> candidates;
+            // drop halves, quarters... then single characters
+            for (std::size_t chunk = value.size() / 2; chunk > 0; chunk /= 2) {
+                for (std::size_t begin = 0; begin < value.size(); begin += chunk)
+                    candidates.push_back(value.substr(0, begin)
+                                         + value.substr(std::min(begin + chunk, value.size())));
+            }
+            if (value.size() == 1)
+                candidates.emplace_back();
+            // then simplify characters
+            for (std::size_t i = 0; i < value.size(); ++i) {
+                if (value[i] != 'a') {
+                    candidates.push_back(value);
+                    candidates.back()[i] = 'a';
+                }
+            }
+            return candidates;
+        }
+    };
+
+    template<typename G>
+    class vector {
+        G _element;
+        std::size_t _max_size;
+
+    public:
+        using value_type = std::vector<typename G::value_type>;
+
+        explicit vector(G element, std::size_t max_size = 32)
+            : _element{ std::move(element) }
+            , _max_size{ max_size } {}
+
+        value_type operator()(rng& random) const {
+            const std::size_t size = random.up_to(7) == 0 ? _max_size * random.up_to(1)
+                                                          : random.up_to(_max_size);
+            value_type value;
+            value.reserve(size);
+            for (std::size_t i = 0; i < size; ++i)
+                value.push_back(_element(random));
+            return value;
+        }
+
+        std::vector<value_type> shrink(const value_type& value) const {
+            std::vector<value_type> candidates;
+            for (std::size_t chunk = value.size() / 2; chunk > 0; chunk /= 2) {
+                for (std::size_t begin = 0; begin < value.size(); begin += chunk) {
+                    candidates.emplace_back(value.begin(), value.begin() + begin);
+                    candidates.back().insert(candidates.back().end(),
+                                             value.begin() + std::min(begin + chunk, value.size()),
+                                             value.end());
+                }
+            }
+            if (value.size() == 1)
+                candidates.emplace_back();
+            for (std::size_t i = 0; i < value.size(); ++i) {
+                for (auto& element : _element.shrink(value[i])) {
+                    candidates.push_back(value);
+                    candidates.back()[i] = std::move(element);
+                }
+            }
+            return candidates;
+        }
+    };
+
+    template<typename T>
+    std::string describe(const T& value) {
+        if constexpr (std::is_same_v<T, bool>)
+            return value ? "true" : "false";
+        else if constexpr (std::is_integral_v<T> && sizeof(T) == 1)
+            return std::to_string(static_cast<int>(value));
+        else if constexpr (std::is_integral_v<T>)
+            return std::to_string(value);
+        else if constexpr (std::is_same_v<T, std::string>)
+            return '"' + value + '"';
+        else {
+            std::string description{ "[" };
+            for (const auto& element : value) {
+                description += description.size() > 1 ? ", " : "";
+                description += describe(element);
+            }
+            return description + ']';
+        }
+    }
+
+    template<typename Predicate, typename... Generators>
+    class property final : public test::property_runner {
+        using values_type = std::tuple<typename Generators::value_type...>;
+        static constexpr std::size_t max_shrink_steps{ 10000 };
+
+        Predicate& _predicate;
+        std::tuple<const Generators&...> _generators;
+
+        values_type generate(std::uint64_t seed) const {
+            rng random{ seed };
+            // braces force the left to right evaluation of the generators
+            return std::apply(
+              [&random](const auto&... generator) { return values_type{ generator(random)... }; },
+              _generators);
+        }
+
+        bool holds(const values_type& values) {
+            try {
+                return static_cast<bool>(std::apply(_predicate, values));
+            } catch (...) {
+                return false;
+            }
+        }
+
+        // replace one value by a smaller one while the predicate still fails
+        template<std::size_t I>
+        bool shrink_one(values_type& values) {
+            for (auto& candidate : std::get<I>(_generators).shrink(std::get<I>(values))) {
+                values_type smaller{ values };
+                std::get<I>(smaller) = std::move(candidate);
+                if (!holds(smaller)) {
+                    values = std::move(smaller);
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        template<std::size_t... I>
+        bool shrink_any(values_type& values, std::index_sequence<I...>) {
+            return (shrink_one<I>(values) || ...);
+        }
+
+        template<std::size_t... I>
+        static std::string describe_all(const values_type& values, std::index_sequence<I...>) {
+            std::string description;
+            ((description += (I > 0 ? ", " : "") + describe(std::get<I>(values))), ...);
+            return description;
+        }
+
+    public:
+        property(Predicate& predicate, const Generators&... generators)
+            : _predicate{ predicate }
+            , _generators{ generators... } {}
+
+        bool run(std::uint64_t seed) override { return holds(generate(seed)); }
+
+        std::string shrink(std::uint64_t seed) override {
+            values_type values = generate(seed);
+            constexpr auto indexes = std::index_sequence_for<Generators...>{};
+            for (std::size_t step = 0; step < max_shrink_steps && shrink_any(values, indexes);
+                 ++step) {}
+            return "(" + describe_all(values, indexes) + ")";
+        }
+    };
+
+    template<typename Tuple, std::size_t... I>
+    auto make_property(Tuple&& arguments, std::index_sequence<I...>) {
+        constexpr std::size_t last = std::tuple_size_v<std::remove_reference_t<Tuple>> - 1;
+        using arguments_type = std::remove_reference_t<Tuple>;
+        using predicate_type = std::remove_reference_t<std::tuple_element_t<last, arguments_type>>;
+        using property_type =
+          property<predicate_type, std::remove_cvref_t<std::tuple_element_t<I, arguments_type>>...>;
+        return property_type(std::get<last>(arguments), std::get<I>(arguments)...);
+    }
+}  // namespace gen
+
+template<typename... Args>
+void test::check_property(const char* const group_name,
+                          const char* const description,
+                          Args&&... args) {
+    check_property(__find_group(group_name), description, static_cast<Args&&>(args)...);
+}
+
+template<typename... Args>
+void test::check_property(group_handle group, const char* const description, Args&&... args) {
+    static_assert(sizeof...(Args) >= 2, "check_property takes generators followed by a predicate");
+    auto property = gen::make_property(std::forward_as_tuple(args...),
+                                       std::make_index_sequence<sizeof...(Args) - 1>{});
+    __check_property(group, description, property);
+}
+}  // namespace featurless
+#endif  // FEATURLESS_PROPERTY_HEADER_GUARD
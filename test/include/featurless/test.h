@@ -11,12 +11,37 @@
 // - grouping tests
 // - enabling only some groups of tests
 // - disabling only some tests.
+// - running groups registered with a function on several threads (-j).
+// - running each of these groups in its own process (--isolate), so that a
+//   crash or a timeout only fails its group.
+// - benchmarking a function (min/median/mean/stddev/p99 in the summary).
+//   With --pmu, hardware counters per iteration too (linux).
+// - property tests, see <featurless/property.h>.
+// - checking performance against stored baselines (check_perf).
+// - counting the allocations of a function (check_alloc, require_no_alloc)
+//   and of each group, when linked with featurless::ftest_alloc.
+// - stressing a function on several threads started together (stress).
+// - fixtures built once on first use and shared by the groups.
+// - comparison checks printing their operands on failure (check_eq...).
+// - timing groups and function checks, printing the slowest ones and writing
+//   json or junit reports.
+// - registering tests with FEATURLESS_TEST, evaluated only if their group is
+//   enabled.
+// - splitting the groups between shards run on several machines
+//   (--shard-index, --shard-count).
+// - caching the result of each group next to the program to run the previous
+//   failures first (--failed-first) or alone (--only-failed).
 // You can't disable and enable at the same time. It would be a uselessely
 // powerful feature.
 //
 // Enabling and disabling, will only work if you parse args.
 //
 // Code:
+// FEATURLESS_TEST("mygroupname", "registered before main, evaluated by run()")
+// {
+//     tester.check("mygroupname", "only computed if mygroupname is enabled", expensive());
+// }
+//
 // int main(int argc, const char** argv)
 // {
 //     featurless::test tester;
@@ -25,13 +50,27 @@
 //
 //     tester.add_group("groupA");
 //     tester.add_group("mygroupname");
+//     // a handle avoids looking the group up by name at each check
+//     const auto handle = tester.add_group("table");
+//     for (const auto& row : table)
+//         tester.check(handle, "table row", compute(row.input) == row.expected);
 //     tester.check("mygroupname", "this is what my test do", true);
 //     tester.check("mygroupname", "evaluate a function of 'type' bool f(void)",
 //                  []() { return false; });
 //     tester.require("group0", "this would stop if it was false", true);
 //     tester.check("mygroupname", "also supporting functions/lambdas", []() { return true; });
+//     tester.check("mygroupname", "lambdas can capture", [&]() { return expensive(data); });
 //     tester.check("Evaluating a global test", []() { return true; });
 //
+//     // groups registered with a function or with FEATURLESS_TEST are only
+//     // evaluated by run(), on the number of threads given by -j.
+//     tester.add_group("runnable", [](featurless::test& t) { t.check("runnable", "ok", true); });
+//     tester.run();
+//
+//     // warm up, then time enough iterations of the function to get stable
+//     // statistics. do_not_optimize keeps the compiler from removing the work.
+//     tester.bench("mygroupname", "sum", [&]() { featurless::test::do_not_optimize(a + b); });
+//
 //     tester.print_summary();
 //     return tester.status();
 // }
@@ -43,6 +82,34 @@
 //                      after this argument.
 //    -d, --disable     disable only the groups of tests whose name is provided
 //                      after this argument.
+//    -j, --jobs        number of threads running the groups registered with a
+//                      function (0: one per core, default: 1).
+//    --isolate         run each group registered with a function in its own
+//                      process, up to -j processes at once.
+//    --timeout         seconds after which an isolated group is killed
+//                      (default: 0, never).
+//    --slowest         number of slowest groups and function checks printed
+//                      in the summary (default: 5).
+//    --report=format:path
+//                      write a report of the tests in the file path, format
+//                      being json or junit. Can be repeated.
+//    --seed            seed of the property tests (default: random).
+//    --cases           number of cases of a property test (default: 10000).
+//    --shard-index     index of the shard to run, from 0 (default: 0).
+//    --shard-count     number of shards the groups are split into (default: 1).
+//    --cache           save the results of the groups next to the program, for
+//                      the next runs.
+//    --failed-first    run first the groups which failed in the previous run and
+//                      stop at the first group whose require fails (implies
+//                      --cache).
+//    --only-failed     run only the groups which failed in the previous run
+//                      (implies --cache).
+//    --baselines       file of the performance baselines (default: the program
+//                      path followed by .baselines).
+//    --update-baselines
+//                      write the measures of check_perf as the new baselines.
+//    --pmu             count the cycles, instructions, branch and cache misses
+//                      of the benchmarks (linux perf_event_open).
 //
 // You can do that: program -e group1 group3 group4
 // You can do that: program -d group2
@@ -52,13 +119,85 @@
 #ifndef FEATURLESS_TESTS_HEADER_GUARD
 #define FEATURLESS_TESTS_HEADER_GUARD
 
+#define FEATURLESS_TEST_CONCAT_(a, b) a##b
+#define FEATURLESS_TEST_CONCAT(a, b)  FEATURLESS_TEST_CONCAT_(a, b)
+#define FEATURLESS_TEST_FUNCTION      FEATURLESS_TEST_CONCAT(featurless_test_, __LINE__)
+// Register the following body as a test of group_name, run by tester.run() if
+// the group is enabled. The body receives the tester as 'tester'.
+#define FEATURLESS_TEST(group_name, test_name)                                             \
+    static void FEATURLESS_TEST_FUNCTION(featurless::test& tester);                        \
+    static featurless::test::registration FEATURLESS_TEST_CONCAT(                          \
+      featurless_test_registration_, __LINE__){ group_name, test_name,                     \
+                                                &FEATURLESS_TEST_FUNCTION };               \
+    static void FEATURLESS_TEST_FUNCTION([[maybe_unused]] featurless::test& tester)
+
 namespace featurless {
+template<typename A, typename B>
+inline constexpr bool __is_same_type = false;
+template<typename A>
+inline constexpr bool __is_same_type<A, A> = true;
+
+// Non-owning reference to a callable, it must not outlive the callable.
+template<typename Signature>
+class function_ref;
+
+template<typename R, typename... Args>
+class function_ref<R(Args...)> {
+    union {
+        void* _object;
+        R (*_function)(Args...);
+    };
+    R (*_call)(const function_ref&, Args...);
+
+    template<typename P>
+    static R __call_object(const function_ref& self, Args... args) {
+        return static_cast<R>((*static_cast<P>(self._object))(static_cast<Args&&>(args)...));
+    }
+
+    static R __call_function(const function_ref& self, Args... args) {
+        return self._function(static_cast<Args&&>(args)...);
+    }
+
+public:
+    function_ref(R (*function)(Args...)) noexcept
+        : _function{ function }
+        , _call{ &__call_function } {}
+
+    template<typename F>
+    requires(!__is_same_type<F, function_ref&> && !__is_same_type<F, const function_ref&>
+             && requires(F& f, Args&&... args) { f(static_cast<Args&&>(args)...); })
+    function_ref(F&& callable) noexcept
+        : _object{ const_cast<void*>(static_cast<const void*>(&callable)) }
+        , _call{ &__call_object<decltype(&callable)> } {}
+
+    R operator()(Args... args) const { return _call(*this, static_cast<Args&&>(args)...); }
+};
+
+template<typename F>
+concept __test_condition = requires(F& f) { static_cast<bool>(f()); };
+
 class test {
     struct Data;
-    typedef bool testfun_t();
+    typedef function_ref<bool()> testfun_t;
+    typedef function_ref<void()> allocfun_t;
+    typedef function_ref<bool(unsigned, unsigned long long)> stressfun_t;
+    typedef void fixturefun_t();
+    typedef void groupfun_t(test&);
+    typedef void benchfun_t(void* context, unsigned long long iterations);
     static constexpr int line_width{ 73 };
 
 public:
+    // Returned by add_group, checks using it skip the group name lookup.
+    class group_handle {
+        friend class test;
+        long _index{ -1 };
+        explicit group_handle(long index) noexcept
+            : _index{ index } {}
+
+    public:
+        group_handle() noexcept = default;
+    };
+
     test();
     ~test();
     test(test&) = delete;
@@ -67,26 +206,418 @@ public:
 
     void parse_args(int argc, const char** argv);
 
-    void add_group(const char* const group_name);
+    group_handle add_group(const char* const group_name);
+    group_handle add_group(const char* const group_name, groupfun_t run);
+    void set_timeout(const char* const group_name, unsigned seconds);
 
+    void run();
+
+    // A fixture is built by setup on its first fixture() call, shared read-only
+    // by all the groups and threads, and destroyed by teardown (delete by
+    // default) in the reverse order of construction when the tester is. Ask
+    // for it in group functions: a fixture no enabled group uses is never built.
+    template<typename T>
+    void add_fixture(const char* const name,
+                     T* (*setup)(),
+                     void (*teardown)(T*) = &__delete_fixture<T>) {
+        __add_fixture(name, reinterpret_cast<fixturefun_t*>(setup), &__setup_fixture<T>,
+                      reinterpret_cast<fixturefun_t*>(teardown), &__teardown_fixture<T>);
+    }
+    // nullptr if the fixture is unknown or its setup returned nullptr.
+    template<typename T>
+    const T* fixture(const char* const name) {
+        return static_cast<const T*>(__fixture(name));
+    }
+
+    // A function given as a condition is only called if the check is performed.
+    // The templates only exist so that functions are not converted to bool.
     void require(const char* const description, bool condition);
-    void require(const char* const description, testfun_t condition);
     void require(const char* const group_name, const char* const description, bool condition);
-    void require(const char* const group_name, const char* const description, testfun_t condition);
+    void require(group_handle group, const char* const description, bool condition);
+    template<__test_condition F>
+    void require(const char* const description, F&& condition) {
+        __require_function(description, testfun_t(condition));
+    }
+    template<__test_condition F>
+    void require(const char* const group_name, const char* const description, F&& condition) {
+        __require_function(__find_group(group_name), description, testfun_t(condition));
+    }
+    template<__test_condition F>
+    void require(group_handle group, const char* const description, F&& condition) {
+        __require_function(group, description, testfun_t(condition));
+    }
 
     void check(const char* const description, bool condition);
-    void check(const char* const description, testfun_t condition);
     void check(const char* const group_name, const char* const description, bool condition);
-    void check(const char* const group_name, const char* const description, testfun_t condition);
+    void check(group_handle group, const char* const description, bool condition);
+    template<__test_condition F>
+    void check(const char* const description, F&& condition) {
+        __check_function(description, testfun_t(condition));
+    }
+    template<__test_condition F>
+    void check(const char* const group_name, const char* const description, F&& condition) {
+        __check_function(__find_group(group_name), description, testfun_t(condition));
+    }
+    template<__test_condition F>
+    void check(group_handle group, const char* const description, F&& condition) {
+        __check_function(group, description, testfun_t(condition));
+    }
+
+    // Fail if fun allocates more than max_count times or max_bytes bytes. Only
+    // the allocations of the calling thread are counted, and only if the
+    // featurless::ftest_alloc library is linked: they fail otherwise.
+    template<typename F>
+    void check_alloc(const char* const group_name,
+                     const char* const description,
+                     F&& fun,
+                     unsigned long long max_count,
+                     unsigned long long max_bytes) {
+        __check_alloc(__find_group(group_name), description, allocfun_t(fun), max_count, max_bytes,
+                      false);
+    }
+    template<typename F>
+    void check_alloc(group_handle group,
+                     const char* const description,
+                     F&& fun,
+                     unsigned long long max_count,
+                     unsigned long long max_bytes) {
+        __check_alloc(group, description, allocfun_t(fun), max_count, max_bytes, false);
+    }
+    template<typename F>
+    void check_no_alloc(const char* const group_name, const char* const description, F&& fun) {
+        __check_alloc(__find_group(group_name), description, allocfun_t(fun), 0, 0, false);
+    }
+    template<typename F>
+    void check_no_alloc(group_handle group, const char* const description, F&& fun) {
+        __check_alloc(group, description, allocfun_t(fun), 0, 0, false);
+    }
+    template<typename F>
+    void require_no_alloc(const char* const group_name, const char* const description, F&& fun) {
+        __check_alloc(__find_group(group_name), description, allocfun_t(fun), 0, 0, true);
+    }
+    template<typename F>
+    void require_no_alloc(group_handle group, const char* const description, F&& fun) {
+        __check_alloc(group, description, allocfun_t(fun), 0, 0, true);
+    }
+
+    // Calls fun(thread_index, iteration) iterations times on each of the
+    // threads, started together from a spin barrier. The check fails if a call
+    // returns false or throws; the checks made by fun are counted too. Flags:
+    static constexpr unsigned stress_pin{ 1 };    // pin the threads to distinct cores (linux)
+    static constexpr unsigned stress_yield{ 2 };  // yield at random between iterations and
+                                                  // at the yield_point() calls of fun
+    template<typename F>
+    void stress(const char* const group_name,
+                const char* const description,
+                unsigned threads,
+                unsigned long long iterations,
+                F&& fun,
+                unsigned flags = 0) {
+        __stress(__find_group(group_name), description, threads, iterations, stressfun_t(fun),
+                 flags);
+    }
+    template<typename F>
+    void stress(group_handle group,
+                const char* const description,
+                unsigned threads,
+                unsigned long long iterations,
+                F&& fun,
+                unsigned flags = 0) {
+        __stress(group, description, threads, iterations, stressfun_t(fun), flags);
+    }
+    // widens the race windows of a stress with stress_yield, no-op otherwise.
+    static void yield_point() noexcept;
+
+    // Compare inline, the operands are only formatted if the comparison fails.
+    // Fundamental types, pointers and string-like types (data() and size())
+    // are printed, the others are not. C strings are compared by content.
+    template<typename A, typename B>
+    void check_eq(group_handle group, const char* const description, const A& a, const B& b) {
+        if (__equal(a, b))
+            check(group, description, true);
+        else
+            __compare_failed(group, description, __to_operand(a), "==", __to_operand(b));
+    }
+    template<typename A, typename B>
+    void check_ne(group_handle group, const char* const description, const A& a, const B& b) {
+        if (!__equal(a, b))
+            check(group, description, true);
+        else
+            __compare_failed(group, description, __to_operand(a), "!=", __to_operand(b));
+    }
+    template<typename A, typename B>
+    void check_lt(group_handle group, const char* const description, const A& a, const B& b) {
+        if (a < b)
+            check(group, description, true);
+        else
+            __compare_failed(group, description, __to_operand(a), "<", __to_operand(b));
+    }
+    template<typename A, typename B>
+    void check_le(group_handle group, const char* const description, const A& a, const B& b) {
+        if (a <= b)
+            check(group, description, true);
+        else
+            __compare_failed(group, description, __to_operand(a), "<=", __to_operand(b));
+    }
+    // |a - b| <= tolerance, false if one of them is NaN
+    template<typename A, typename B, typename T>
+    void check_near(group_handle group,
+                    const char* const description,
+                    const A& a,
+                    const B& b,
+                    const T& tolerance) {
+        if ((a < b ? b - a : a - b) <= tolerance)
+            check(group, description, true);
+        else
+            __compare_failed(group, description, __to_operand(a), "~", __to_operand(b),
+                             __to_operand(tolerance));
+    }
+    template<typename A, typename B>
+    void check_eq(const char* const group_name,
+                  const char* const description,
+                  const A& a,
+                  const B& b) {
+        check_eq(__find_group(group_name), description, a, b);
+    }
+    template<typename A, typename B>
+    void check_ne(const char* const group_name,
+                  const char* const description,
+                  const A& a,
+                  const B& b) {
+        check_ne(__find_group(group_name), description, a, b);
+    }
+    template<typename A, typename B>
+    void check_lt(const char* const group_name,
+                  const char* const description,
+                  const A& a,
+                  const B& b) {
+        check_lt(__find_group(group_name), description, a, b);
+    }
+    template<typename A, typename B>
+    void check_le(const char* const group_name,
+                  const char* const description,
+                  const A& a,
+                  const B& b) {
+        check_le(__find_group(group_name), description, a, b);
+    }
+    template<typename A, typename B, typename T>
+    void check_near(const char* const group_name,
+                    const char* const description,
+                    const A& a,
+                    const B& b,
+                    const T& tolerance) {
+        check_near(__find_group(group_name), description, a, b, tolerance);
+    }
+
+    // filled before main by FEATURLESS_TEST, read by run().
+    struct registration {
+        registration(const char* const group_name,
+                     const char* const test_name,
+                     groupfun_t* test_function) noexcept;
+
+        const char* const group;
+        const char* const name;
+        groupfun_t* const function;
+        registration* next{ nullptr };
+    };
+
+    template<typename F>
+    void bench(const char* const group_name, const char* const description, F fun) {
+        __bench(__find_group(group_name), description, &fun, &__bench_loop<F>);
+    }
+    template<typename F>
+    void bench(group_handle group, const char* const description, F fun) {
+        __bench(group, description, &fun, &__bench_loop<F>);
+    }
+
+    // Fails if the median time of fun exceeds its baseline by more than
+    // tolerance (0.1: 10% slower), beyond the noise of the measure.
+    template<typename F>
+    void check_perf(const char* const group_name,
+                    const char* const description,
+                    F fun,
+                    double tolerance) {
+        __check_perf(__find_group(group_name), description, &fun, &__bench_loop<F>, tolerance);
+    }
+    template<typename F>
+    void check_perf(group_handle group, const char* const description, F fun, double tolerance) {
+        __check_perf(group, description, &fun, &__bench_loop<F>, tolerance);
+    }
+
+    template<typename T>
+    static inline void do_not_optimize(T const& value) noexcept {
+#if defined(__GNUC__)
+        asm volatile("" : : "r,m"(value) : "memory");
+#else
+        __escape(&value);
+#endif
+    }
+
+    static inline void clobber() noexcept {
+#if defined(__GNUC__)
+        asm volatile("" : : : "memory");
+#else
+        __escape(nullptr);
+#endif
+    }
+
+    // Defined in <featurless/property.h>, include it to use them.
+    class property_runner;
+    template<typename... Args>
+    void check_property(const char* const group_name,
+                        const char* const description,
+                        Args&&... args);
+    template<typename... Args>
+    void check_property(group_handle group, const char* const description, Args&&... args);
 
     void print_summary() const;
 
     int status() const noexcept;
 
 private:
-    bool is_group_enabled(const char* const group_name);
-    bool __check(const char* const description, bool condition);
-    bool __check(const char* const description, const char* const group_name, bool condition);
+    // A value to print, built only on failure. The constructors and the
+    // formatting are out of line to keep test.h light.
+    class __operand {
+        friend class test;
+        enum : unsigned char { none, boolean, character, signed_int, unsigned_int, floating,
+                               pointer, chars } _kind{ none };
+        union {
+            long long _signed;
+            unsigned long long _unsigned;
+            double _floating;
+            const void* _pointer;
+            const char* _chars{ nullptr };
+        };
+        unsigned long _size{ 0 };
+
+    public:
+        __operand() noexcept {}
+        __operand(bool value) noexcept;
+        __operand(char value) noexcept;
+        __operand(signed char value) noexcept;
+        __operand(unsigned char value) noexcept;
+        __operand(short value) noexcept;
+        __operand(unsigned short value) noexcept;
+        __operand(int value) noexcept;
+        __operand(unsigned int value) noexcept;
+        __operand(long value) noexcept;
+        __operand(unsigned long value) noexcept;
+        __operand(long long value) noexcept;
+        __operand(unsigned long long value) noexcept;
+        __operand(float value) noexcept;
+        __operand(double value) noexcept;
+        __operand(long double value) noexcept;
+        __operand(const void* value) noexcept;
+        __operand(const char* value) noexcept;
+        __operand(const char* data, unsigned long size) noexcept;
+    };
+
+    template<typename A, typename B>
+    static bool __equal(const A& a, const B& b) {
+        if constexpr (requires {
+                          static_cast<const char*>(a);
+                          static_cast<const char*>(b);
+                      })
+            return __equal_chars(a, b);
+        else
+            return a == b;
+    }
+    static bool __equal_chars(const char* a, const char* b) noexcept;
+
+    template<typename T>
+    static __operand __to_operand(const T& value) noexcept {
+        if constexpr (requires(const char* data, unsigned long size) {
+                          data = value.data();
+                          size = value.size();
+                      })
+            return __operand(value.data(), value.size());
+        else if constexpr (requires { static_cast<__operand>(value); })
+            return static_cast<__operand>(value);
+        else
+            return __operand();
+    }
+
+    group_handle __find_group(const char* const group_name);
+    bool __check(const char* const description, bool condition, long long duration_ns = -1);
+    bool __check(const char* const description,
+                 long group_index,
+                 bool condition,
+                 long long duration_ns = -1);
+    void __check_function(const char* const description, testfun_t condition);
+    void __check_function(group_handle group, const char* const description, testfun_t condition);
+    void __require_function(const char* const description, testfun_t condition);
+    void __require_function(group_handle group,
+                            const char* const description,
+                            testfun_t condition);
+    bool __stopped(long group_index);
+    void __require_failed();
+    void __group_require_failed(long group_index);
+    void __run_group(unsigned long group_index);
+    void __run_pending(const unsigned long* group_indexes, unsigned long count);
+    void __run_isolated(const unsigned long* group_indexes, unsigned long count);
+    void __fail_group(unsigned long group_index, const char* const reason, signed char status);
+    void __bench(group_handle group,
+                 const char* const description,
+                 void* context,
+                 benchfun_t loop);
+    void __check_perf(group_handle group,
+                      const char* const description,
+                      void* context,
+                      benchfun_t loop,
+                      double tolerance);
+    void __check_alloc(group_handle group,
+                       const char* const description,
+                       allocfun_t function,
+                       unsigned long long max_count,
+                       unsigned long long max_bytes,
+                       bool required);
+    void __stress(group_handle group,
+                  const char* const description,
+                  unsigned threads,
+                  unsigned long long iterations,
+                  stressfun_t function,
+                  unsigned flags);
+    void __add_fixture(const char* const name,
+                       fixturefun_t* setup,
+                       void* (*setup_thunk)(fixturefun_t*),
+                       fixturefun_t* teardown,
+                       void (*teardown_thunk)(fixturefun_t*, void*));
+    const void* __fixture(const char* const name);
+    void __teardown_fixtures(unsigned long first);
+    void __compare_failed(group_handle group,
+                          const char* const description,
+                          const __operand& a,
+                          const char* const comparison,
+                          const __operand& b,
+                          const __operand& tolerance = __operand());
+    static void __escape(const volatile void* pointer) noexcept;
+    void __check_property(group_handle group,
+                          const char* const description,
+                          property_runner& property);
+    void __print_slowest() const;
+    void __write_baselines();
+    bool __write_report(const char* const format, const char* const path) const;
+
+    template<typename T>
+    static void __delete_fixture(T* object) {
+        delete object;
+    }
+    template<typename T>
+    static void* __setup_fixture(fixturefun_t* setup) {
+        return reinterpret_cast<T* (*)()>(setup)();
+    }
+    template<typename T>
+    static void __teardown_fixture(fixturefun_t* teardown, void* object) {
+        reinterpret_cast<void (*)(T*)>(teardown)(static_cast<T*>(object));
+    }
+
+    template<typename F>
+    static void __bench_loop(void* context, unsigned long long iterations) {
+        F& fun = *static_cast<F*>(context);
+        for (; iterations > 0; --iterations)
+            fun();
+    }
+
     Data* _data;
 };
 }  // namespace featurless
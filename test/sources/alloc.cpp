@@ -0,0 +1,179 @@
+// Allocation tracker of featurless_test_alloc: counts the allocations of each
+// thread for check_alloc and the group summaries. Linking this object library
+// replaces the global operator new and, with the glibc, malloc itself, so
+// that C allocations are counted too.
+#include "alloc_tracker.h"
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+using featurless::alloc_tracker::thread_counters;
+
+static bool install() noexcept {
+    featurless::alloc_tracker::installed = true;
+    return true;
+}
+
+static const bool installed_at_startup = install();
+
+static inline void count(std::size_t size) noexcept {
+    if (featurless::alloc_tracker::suspended != 0)
+        return;
+    ++thread_counters.count;
+    thread_counters.bytes += size;
+}
+
+// the sanitizers intercept malloc themselves, going around them through the
+// glibc entry points crashes (thread) or hides errors (address): only
+// operator new is replaced in their builds.
+#if defined(__GLIBC__) && !defined(__SANITIZE_ADDRESS__) && !defined(__SANITIZE_THREAD__)
+#define FEATURLESS_ALLOC_HOOK_MALLOC
+#endif
+#if defined(__has_feature)
+#if __has_feature(address_sanitizer) || __has_feature(thread_sanitizer) \
+  || __has_feature(memory_sanitizer)
+#undef FEATURLESS_ALLOC_HOOK_MALLOC
+#endif
+#endif
+
+#if defined(FEATURLESS_ALLOC_HOOK_MALLOC)
+// the glibc exports its allocator under these names, malloc is replaced and
+// operator new goes through it, each allocation is counted once.
+extern "C" {
+void* __libc_malloc(std::size_t size);
+void* __libc_calloc(std::size_t count, std::size_t size);
+void* __libc_realloc(void* pointer, std::size_t size);
+void* __libc_memalign(std::size_t alignment, std::size_t size);
+void __libc_free(void* pointer);
+
+void* malloc(std::size_t size) {
+    count(size);
+    return __libc_malloc(size);
+}
+
+void* calloc(std::size_t nb_elements, std::size_t size) {
+    count(nb_elements * size);
+    return __libc_calloc(nb_elements, size);
+}
+
+void* realloc(void* pointer, std::size_t size) {
+    count(size);
+    return __libc_realloc(pointer, size);
+}
+
+void* memalign(std::size_t alignment, std::size_t size) {
+    count(size);
+    return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(std::size_t alignment, std::size_t size) {
+    return memalign(alignment, size);
+}
+
+int posix_memalign(void** pointer, std::size_t alignment, std::size_t size) {
+    if (alignment % sizeof(void*) != 0 || (alignment & (alignment - 1)) != 0)
+        return EINVAL;
+    void* const result = memalign(alignment, size);
+    if (result == nullptr)
+        return ENOMEM;
+    *pointer = result;
+    return 0;
+}
+
+void free(void* pointer) {
+    __libc_free(pointer);
+}
+}
+
+static void* allocate(std::size_t size) noexcept {
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* allocate_aligned(std::size_t size, std::align_val_t alignment) noexcept {
+    count(size);
+    return __libc_memalign(static_cast<std::size_t>(alignment), size == 0 ? 1 : size);
+}
+#else
+static void* allocate(std::size_t size) noexcept {
+    count(size);
+    return std::malloc(size == 0 ? 1 : size);
+}
+
+static void* allocate_aligned(std::size_t size, std::align_val_t alignment) noexcept {
+    count(size);
+    const auto align = static_cast<std::size_t>(alignment);
+    return std::aligned_alloc(align, (size + align - 1) / align * align);
+}
+#endif
+
+void* operator new(std::size_t size) {
+    void* const pointer = allocate(size);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept {
+    return allocate(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    void* const pointer = allocate_aligned(size, alignment);
+    if (pointer == nullptr)
+        throw std::bad_alloc();
+    return pointer;
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate_aligned(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment, const std::nothrow_t&) noexcept {
+    return allocate_aligned(size, alignment);
+}
+
+void operator delete(void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete[](void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
@@ -0,0 +1,35 @@
+// Shared by tests.cpp, which owns the counters, and alloc.cpp, compiled in
+// the opt-in featurless_test_alloc library, which replaces the allocation
+// functions to increment them.
+#ifndef FEATURLESS_ALLOC_TRACKER_HEADER_GUARD
+#define FEATURLESS_ALLOC_TRACKER_HEADER_GUARD
+
+#include <cstdint>
+
+namespace featurless::alloc_tracker {
+struct counters {
+    uint64_t count;
+    uint64_t bytes;
+};
+
+// true once featurless_test_alloc is linked and initialized.
+extern bool installed;
+
+// allocations of the calling thread since it started, constant initialized so
+// that reading them never allocates.
+extern constinit thread_local counters thread_counters;
+
+// not 0 while the tester allocates for its own bookkeeping (records, output,
+// messages of isolated groups), which is not counted.
+extern constinit thread_local unsigned suspended;
+
+class suspend_counting {
+public:
+    suspend_counting() noexcept { ++suspended; }
+    ~suspend_counting() { --suspended; }
+    suspend_counting(const suspend_counting&) = delete;
+    suspend_counting& operator=(const suspend_counting&) = delete;
+};
+}  // namespace featurless::alloc_tracker
+
+#endif  // FEATURLESS_ALLOC_TRACKER_HEADER_GUARD
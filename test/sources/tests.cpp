@@ -1,41 +1,742 @@
 #include "featurless/test.h"
+#include "featurless/property.h"
+#include "alloc_tracker.h"
 #include <algorithm>
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
 #include <cstdint>
+#include <deque>
 #include <iomanip>
+#include <fstream>
 #include <iostream>
+#include <iterator>
+#include <mutex>
+#include <sstream>
 #include <string>
 #include <string_view>
+#include <thread>
 #include <unordered_map>
 #include <utility>
 #include <vector>
+#if defined(__unix__) || defined(__APPLE__)
+#define FEATURLESS_TEST_FORK
+#include <cerrno>
+#include <csignal>
+#include <poll.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
 
 enum class FilterType { none = 0, enabled = 1, disabled = 2 };
 
-enum class StatusCode : int8_t { ok = 0, help = -1, argerror = 1, requirefail = 2 };
+enum class StatusCode : int8_t {
+    ok = 0,
+    help = -1,
+    argerror = 1,
+    requirefail = 2,
+    crashed = 3,
+    timeout = 4
+};
 
 struct Stats {
     StatusCode status{ StatusCode::ok };
-    uint8_t count_checks{ 0 };
-    uint8_t count_success{ 0 };
-    uint8_t count_total{ 0 };
+    uint64_t count_checks{ 0 };
+    uint64_t count_success{ 0 };
+    uint64_t count_total{ 0 };
+    int64_t duration_ns{ 0 };  // group functions and function checks
+    // allocations of the group functions and the allocation checks, counted if
+    // featurless_test_alloc is linked.
+    uint64_t alloc_count{ 0 };
+    uint64_t alloc_bytes{ 0 };
+};
+
+// Function checks, which are timed, and failures, kept for the reports.
+struct CheckRecord {
+    long group;  // -1: global
+    std::string description;
+    int64_t duration_ns;  // -1: not timed
+    bool success;
+};
+
+struct StressResult {
+    std::string group;
+    std::string description;
+    uint64_t iterations;  // per thread
+    int64_t duration_ns;
+    std::vector<uint64_t> failures;  // per thread
+};
+
+// hardware counters of --pmu, in the order of HardwareCounters
+constexpr std::size_t nb_counters{ 5 };
+constexpr const char* counter_names[nb_counters]{ "cycles", "instructions", "branch_misses",
+                                                  "l1d_misses", "llc_misses" };
+
+struct BenchResult {
+    std::string group;
+    std::string description;
+    std::size_t samples;
+    uint64_t iterations;  // per sample
+    // nanoseconds per iteration
+    double min;
+    double median;
+    double mean;
+    double stddev;
+    double p99;
+    // per iteration, NaN when not counted
+    double counters[nb_counters]{ NAN, NAN, NAN, NAN, NAN };
+};
+
+// Cycles, instructions, branch misses, L1D and LLC read misses of this
+// thread in user space, counted together as one perf_event group led by the
+// cycles. The counters the CPU does not have are left out, without the
+// cycles nothing is counted (no PMU in most containers and VMs).
+class HardwareCounters {
+#if defined(__linux__)
+    int _fds[nb_counters]{ -1, -1, -1, -1, -1 };
+    uint64_t _ids[nb_counters]{};
+
+public:
+    // an empty string on success, the reason of the failure otherwise
+    std::string open() {
+        constexpr uint64_t cache_read_miss =
+          (PERF_COUNT_HW_CACHE_OP_READ << 8U) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16U);
+        const std::pair<uint32_t, uint64_t> events[nb_counters]{
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | cache_read_miss },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_LL | cache_read_miss },
+        };
+        for (std::size_t i = 0; i < nb_counters; ++i) {
+            perf_event_attr attr{};
+            attr.size = sizeof(attr);
+            attr.type = events[i].first;
+            attr.config = events[i].second;
+            attr.disabled = i == 0 ? 1 : 0;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv = 1;
+            attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID | PERF_FORMAT_TOTAL_TIME_ENABLED
+                               | PERF_FORMAT_TOTAL_TIME_RUNNING;
+            _fds[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0, -1, _fds[0], 0));
+            if (_fds[i] < 0 && i == 0)
+                return std::string("perf_event_open: ") + std::strerror(errno);
+            if (_fds[i] >= 0)
+                ::ioctl(_fds[i], PERF_EVENT_IOC_ID, &_ids[i]);
+        }
+        return {};
+    }
+
+    ~HardwareCounters() {
+        for (const int fd : _fds) {
+            if (fd >= 0)
+                ::close(fd);
+        }
+    }
+
+    void start() noexcept {
+        ::ioctl(_fds[0], PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ::ioctl(_fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+
+    // totals divided by iterations, scaled if the kernel multiplexed the group
+    void stop(uint64_t iterations, double (&counters)[nb_counters]) noexcept {
+        ::ioctl(_fds[0], PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+        struct {
+            uint64_t nr;
+            uint64_t time_enabled;
+            uint64_t time_running;
+            struct {
+                uint64_t value;
+                uint64_t id;
+            } values[nb_counters];
+        } group{};
+        if (::read(_fds[0], &group, sizeof(group)) <= 0 || group.time_running == 0)
+            return;
+        const double scale = static_cast<double>(group.time_enabled)
+                             / static_cast<double>(group.time_running)
+                             / static_cast<double>(iterations);
+        for (uint64_t i = 0; i < group.nr && i < nb_counters; ++i) {
+            for (std::size_t j = 0; j < nb_counters; ++j) {
+                if (_fds[j] >= 0 && _ids[j] == group.values[i].id)
+                    counters[j] = static_cast<double>(group.values[i].value) * scale;
+            }
+        }
+    }
+#else
+public:
+    std::string open() { return "not supported on this platform"; }
+    void start() noexcept {}
+    void stop(uint64_t, double (&)[nb_counters]) noexcept {}
+#endif
+};
+
+struct GroupRun {
+    void (*function)(featurless::test&);
+    const char* test_name;  // of FEATURLESS_TEST, nullptr for add_group
+};
+
+struct Group {
+    std::string name;
+    bool enabled{ true };  // -e/-d and shard decision, cached
+    Stats stats;
+    std::vector<GroupRun> runs;
+    unsigned timeout{ 0 };  // seconds, 0: use the --timeout value
+    bool ran{ false };      // started by run(), its result goes to the cache
+};
+
+// Type-erased add_fixture arguments, the thunks cast the functions back to
+// their real type. The object is built once, by the first fixture() call.
+struct Fixture {
+    std::string name;
+    void (*setup)();
+    void* (*setup_thunk)(void (*)());
+    void (*teardown)();
+    void (*teardown_thunk)(void (*)(), void*);
+    void* object{ nullptr };
+    std::once_flag built;
 };
 
+// Result of a group in a previous run, read from the cache file.
+struct CacheEntry {
+    signed char status;
+    uint64_t failures;
+    int64_t duration_ns;
+
+    bool failed() const noexcept { return status != 0 || failures > 0; }
+};
+
+// allows to find a group from its name without building a std::string
+struct StringHash {
+    using is_transparent = void;
+    std::size_t operator()(const std::string_view value) const noexcept {
+        return std::hash<std::string_view>{}(value);
+    }
+};
+
+// FNV-1a, unlike std::hash it gives the same value on every machine, so that
+// all the shards agree on the groups they run.
+static uint64_t stable_hash(const std::string_view value) noexcept {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const char c : value) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
 struct featurless::test::Data {
     FilterType filter_type{ FilterType::none };
+    unsigned jobs{ 1 };
+    bool isolate{ false };
+    unsigned timeout{ 0 };
+    unsigned slowest{ 5 };
+    uint64_t seed{ static_cast<uint64_t>(
+      std::chrono::high_resolution_clock::now().time_since_epoch().count()) };
+    unsigned property_cases{ 10000 };
+    unsigned shard_index{ 0 };
+    unsigned shard_count{ 1 };
+    bool failed_first{ false };
+    bool only_failed{ false };
+    bool use_cache{ false };
+    std::string cache_path;  // empty: parse_args was not called
+    std::unordered_map<std::string, CacheEntry, StringHash, std::equal_to<>> cache;
+    bool update_baselines{ false };
+    std::string baselines_path;
+    // median ns per iteration, keyed by "group\tdescription"
+    std::unordered_map<std::string, double> baselines;
+    std::vector<std::pair<std::string, double>> baseline_updates;
+    std::vector<std::pair<std::string, std::string>> reports;  // format, path
     Stats global_stats;
 
-    std::unordered_map<std::string, Stats> groups_stats;
+    std::vector<Group> groups;
+    std::unordered_map<std::string, std::size_t, StringHash, std::equal_to<>> groups_index;
     std::vector<std::string> filter_values;
+    std::vector<BenchResult> benchmarks;
+    bool pmu{ false };
+    std::string pmu_notice;  // why --pmu counts nothing
+    std::vector<StressResult> stress_results;
+    // a deque never moves the fixtures, their once_flag can not be moved
+    std::deque<Fixture> fixtures;
+    std::unordered_map<std::string, std::size_t, StringHash, std::equal_to<>> fixtures_index;
+    std::vector<std::size_t> built_fixtures;  // construction order, under results_mutex
+    // fixture index and setup ns, also of the fixtures built by isolated children
+    std::vector<std::pair<std::size_t, int64_t>> fixture_setups;
+    std::vector<CheckRecord> records;        // failures
+    std::vector<CheckRecord> slowest_checks;  // heap, see keep_slowest
+
+    // set by a worker thread when a global require fails during run()
+    std::atomic<bool> stopped{ false };
+    // set when a group fails with --failed-first, the groups not started yet
+    // are not run.
+    std::atomic<bool> skip_pending{ false };
+    // set by run() while the groups run, the groups can not be added: they
+    // are read by the workers without lock.
+    bool running{ false };
+    std::mutex output_mutex;
+    std::mutex results_mutex;
+
+    // global checks are evaluated in every shard, for their requires to stop
+    // the same groups, but only counted and reported by the first one
+    bool global_enabled() const noexcept { return shard_index == 0; }
+
+    bool is_enabled(const std::string_view group_name) const {
+        if (shard_count > 1 && stable_hash(group_name) % shard_count != shard_index)
+            return false;
+        if (filter_type == FilterType::none)
+            return true;
+        const auto value = std::find(filter_values.cbegin(), filter_values.cend(), group_name);
+        return (filter_type == FilterType::disabled && value == filter_values.cend())
+               || (filter_type == FilterType::enabled && value != filter_values.cend());
+    }
+};
+
+// Stats accumulated by a thread of run(), merged once all groups are done.
+// Failures are buffered and flushed at the end of each group function, so the
+// output of two groups never interleaves.
+// An isolated child process uses a worker too, sending its output to the
+// parent through a pipe instead of printing it.
+struct Worker {
+    Stats global;
+    std::vector<Stats> groups;
+    std::vector<CheckRecord> records;
+    std::vector<CheckRecord> slowest_checks;
+    std::string output;
+    int pipe{ -1 };
+};
+
+static thread_local Worker* current_worker{ nullptr };
+// function checks run by a group function are already part of its duration
+static thread_local bool running_group{ false };
+// name of the FEATURLESS_TEST being run, given with its failures
+static thread_local const char* running_test{ nullptr };
+
+using steady_clock = std::chrono::steady_clock;
+
+bool featurless::alloc_tracker::installed{ false };
+constinit thread_local featurless::alloc_tracker::counters
+  featurless::alloc_tracker::thread_counters{ 0, 0 };
+constinit thread_local unsigned featurless::alloc_tracker::suspended{ 0 };
+
+static long long elapsed_ns(steady_clock::time_point start) noexcept {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(steady_clock::now() - start)
+      .count();
+}
+
+class WorkQueue {
+    std::mutex _mutex;
+    std::deque<std::size_t> _tasks;
+
+public:
+    void push(std::size_t task) {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        _tasks.push_back(task);
+    }
+
+    // the owner takes its most recent task, thieves take the oldest one.
+    bool pop(std::size_t& task) {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        if (_tasks.empty())
+            return false;
+        task = _tasks.back();
+        _tasks.pop_back();
+        return true;
+    }
+
+    bool steal(std::size_t& task) {
+        std::lock_guard<std::mutex> lock{ _mutex };
+        if (_tasks.empty())
+            return false;
+        task = _tasks.front();
+        _tasks.pop_front();
+        return true;
+    }
 };
 
+#if defined(FEATURLESS_TEST_FORK)
+static void write_all(int fd, const char* data, std::size_t size) noexcept {
+    while (size > 0) {
+        const ssize_t written = ::write(fd, data, size);
+        if (written < 0 && errno == EINTR)
+            continue;
+        if (written <= 0)
+            return;
+        data += written;
+        size -= static_cast<std::size_t>(written);
+    }
+}
+
+static void send_frame(int fd, char type, const std::string_view payload) noexcept {
+    const std::size_t size = payload.size();
+    char header[1 + sizeof(size)];
+    header[0] = type;
+    std::memcpy(header + 1, &size, sizeof(size));
+    write_all(fd, header, sizeof(header));
+    write_all(fd, payload.data(), size);
+}
+#endif
+
+// An isolated child sends each failure as soon as it is known, so the ones
+// printed before a crash are not lost. The parent prints them once the child
+// is done.
+static void send_if_isolated() noexcept {
+#if defined(FEATURLESS_TEST_FORK)
+    if (current_worker->pipe >= 0) {
+        send_frame(current_worker->pipe, 'o', current_worker->output);
+        current_worker->output.clear();
+    }
+#endif
+}
+
+static Stats& local_stats(Stats& global_stats) noexcept {
+    return current_worker != nullptr ? current_worker->global : global_stats;
+}
+
+static void merge_stats(Stats& into, const Stats& from) noexcept {
+    into.count_checks += from.count_checks;
+    into.count_success += from.count_success;
+    into.count_total += from.count_total;
+    into.duration_ns += from.duration_ns;
+    into.alloc_count += from.alloc_count;
+    into.alloc_bytes += from.alloc_bytes;
+    if (from.status != StatusCode::ok)
+        into.status = from.status;
+}
+
+// The records and the output are the bookkeeping of the tester, their
+// allocations are not counted in the group which made the check.
+static void record_check(std::vector<CheckRecord>& records,
+                         long group_index,
+                         const char* const description,
+                         int64_t duration_ns,
+                         bool success) {
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    if (current_worker != nullptr)
+        current_worker->records.push_back({ group_index, description, duration_ns, success });
+    else
+        records.push_back({ group_index, description, duration_ns, success });
+}
+
+// Only the `limit` slowest successful checks are kept, in a min-heap: the
+// memory is bounded and a check faster than all of them allocates nothing.
+static void keep_slowest(std::vector<CheckRecord>& slowest,
+                         std::size_t limit,
+                         long group_index,
+                         const std::string_view description,
+                         int64_t duration_ns) {
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    const auto slower = [](const CheckRecord& a, const CheckRecord& b) {
+        return a.duration_ns > b.duration_ns;
+    };
+    if (slowest.size() < limit) {
+        slowest.push_back({ group_index, std::string(description), duration_ns, true });
+        std::push_heap(slowest.begin(), slowest.end(), slower);
+    } else if (limit > 0 && duration_ns > slowest.front().duration_ns) {
+        std::pop_heap(slowest.begin(), slowest.end(), slower);
+        slowest.back().group = group_index;
+        slowest.back().description = description;
+        slowest.back().duration_ns = duration_ns;
+        std::push_heap(slowest.begin(), slowest.end(), slower);
+    }
+}
+
+static void merge_slowest(std::vector<CheckRecord>& into,
+                          std::size_t limit,
+                          const std::vector<CheckRecord>& from) {
+    for (const CheckRecord& record : from)
+        keep_slowest(into, limit, record.group, record.description, record.duration_ns);
+}
+
+static void report_failure(const std::string_view description, std::size_t width);
+
+// a failure in a FEATURLESS_TEST body gives the name of the test
+static void record_failure(std::vector<CheckRecord>& records,
+                           long group_index,
+                           const char* const description,
+                           int64_t duration_ns,
+                           std::size_t width) {
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    if (running_test == nullptr) {
+        report_failure(description, width);
+        record_check(records, group_index, description, duration_ns, false);
+        return;
+    }
+    const std::string located = std::string(description) + " [" + running_test + ']';
+    report_failure(located, width);
+    record_check(records, group_index, located.c_str(), duration_ns, false);
+}
+
+static void report(const std::string_view message) {
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    if (current_worker != nullptr) {
+        current_worker->output.append(message);
+        send_if_isolated();
+    } else
+        std::cout << message;
+}
+
+static void report_failure(const std::string_view description, std::size_t width) {
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    if (current_worker == nullptr) {
+        std::cout << std::left << std::setfill('.') << std::setw(static_cast<int>(width))
+                  << description << "Failure\n";
+        return;
+    }
+    std::string& output = current_worker->output;
+    output.append(description);
+    if (description.size() < width)
+        output.append(width - description.size(), '.');
+    output.append("Failure\n");
+    send_if_isolated();
+}
+
+template<typename T>
+static bool parse_unsigned(const std::string_view value, T& result) {
+    const auto parsed = std::from_chars(value.data(), value.data() + value.size(), result);
+    return !value.empty() && parsed.ec == std::errc() && parsed.ptr == value.data() + value.size();
+}
+
+// Results of an isolated group are sent by the child as frames of
+// [type][payload size][payload]: 'o' for failures output, 'r' for the stats.
+class Message {
+    std::string _bytes;
+
+public:
+    template<typename T>
+    void put(const T& value) {
+        _bytes.append(reinterpret_cast<const char*>(&value), sizeof(T));
+    }
+
+    void put(const std::string_view value) {
+        put(value.size());
+        _bytes.append(value);
+    }
+
+    const std::string& bytes() const noexcept { return _bytes; }
+};
+
+class MessageReader {
+    std::string_view _bytes;
+
+public:
+    explicit MessageReader(const std::string_view bytes) noexcept
+        : _bytes{ bytes } {}
+
+    template<typename T>
+    bool get(T& value) noexcept {
+        if (_bytes.size() < sizeof(T))
+            return false;
+        std::memcpy(&value, _bytes.data(), sizeof(T));
+        _bytes.remove_prefix(sizeof(T));
+        return true;
+    }
+
+    bool get(std::string& value) {
+        std::size_t size = 0;
+        if (!get(size) || _bytes.size() < size)
+            return false;
+        value.assign(_bytes.substr(0, size));
+        _bytes.remove_prefix(size);
+        return true;
+    }
+};
+
+
+// The cache file is a magic number followed by one entry per group:
+// [uint32 name size][name][signed char status][uint64 failures][int64 duration]
+// in the byte order of the machine, it never leaves it.
+static constexpr char cache_magic[4]{ 'F', 'T', 'C', '1' };
+
+template<typename T>
+static bool read_raw(std::istream& file, T& value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(value)));
+}
+
+template<typename T>
+static void write_raw(std::ostream& file, const T& value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(value));
+}
+
+// a missing or corrupted cache is an empty one
+template<typename Map>
+static void read_cache(const std::string& path, Map& cache) {
+    std::ifstream file{ path, std::ios::binary };
+    char magic[sizeof(cache_magic)]{};
+    if (!file.read(magic, sizeof(magic)) || std::memcmp(magic, cache_magic, sizeof(magic)) != 0)
+        return;
+    uint32_t size = 0;
+    std::string name;
+    CacheEntry entry{};
+    while (read_raw(file, size)) {
+        name.resize(size);
+        if (!file.read(name.data(), size) || !read_raw(file, entry.status)
+            || !read_raw(file, entry.failures) || !read_raw(file, entry.duration_ns))
+            return;
+        cache.insert_or_assign(name, entry);
+    }
+}
+
+// written to a temporary file then renamed, so that an interrupted run never
+// leaves a truncated cache. The temporary file is per process: runs of the
+// same program at once do not write into each other, the last one wins.
+template<typename Map>
+static bool write_cache(const std::string& path, const Map& cache) {
+#if defined(FEATURLESS_TEST_FORK)
+    const std::string temporary = path + ".tmp." + std::to_string(::getpid());
+#else
+    const std::string temporary =
+      path + ".tmp." + std::to_string(steady_clock::now().time_since_epoch().count());
+#endif
+    {
+        std::ofstream file{ temporary, std::ios::binary | std::ios::trunc };
+        file.write(cache_magic, sizeof(cache_magic));
+        for (const auto& [name, entry] : cache) {
+            write_raw(file, static_cast<uint32_t>(name.size()));
+            file.write(name.data(), static_cast<std::streamsize>(name.size()));
+            write_raw(file, entry.status);
+            write_raw(file, entry.failures);
+            write_raw(file, entry.duration_ns);
+        }
+        if (!file.flush())
+            return false;
+    }
+    return std::rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+// The baselines file is meant to be versioned: one "median_ns<TAB>group<TAB>
+// description" line per check_perf, sorted, '#' starts a comment line.
+static void read_baselines(const std::string& path,
+                           std::unordered_map<std::string, double>& baselines) {
+    std::ifstream file{ path };
+    std::string line;
+    while (std::getline(file, line)) {
+        const std::size_t separator = line.find('\t');
+        if (line.empty() || line.front() == '#' || separator == std::string::npos)
+            continue;
+        double median = 0;
+        const auto [end, error] = std::from_chars(line.data(), line.data() + separator, median);
+        if (error == std::errc() && end == line.data() + separator && median > 0)
+            baselines.insert_or_assign(line.substr(separator + 1), median);
+    }
+}
+
+static bool write_baselines(const std::string& path,
+                            const std::unordered_map<std::string, double>& baselines) {
+    std::vector<std::pair<std::string, double>> sorted(baselines.begin(), baselines.end());
+    std::sort(sorted.begin(), sorted.end());
+    std::ofstream file{ path, std::ios::trunc };
+    file << "# median_ns\tgroup\tdescription, written by --update-baselines\n"
+         << std::setprecision(6);
+    for (const auto& [key, median] : sorted)
+        file << median << '\t' << key << '\n';
+    return static_cast<bool>(file.flush());
+}
+
+// constant initialized, hence set before the first registration is constructed.
+static featurless::test::registration* first_registration{ nullptr };
+static featurless::test::registration* last_registration{ nullptr };
+
+featurless::test::registration::registration(const char* const group_name,
+                                             const char* const test_name,
+                                             featurless::test::groupfun_t* test_function) noexcept
+    : group{ group_name }
+    , name{ test_name }
+    , function{ test_function } {
+    if (last_registration == nullptr)
+        first_registration = this;
+    else
+        last_registration->next = this;
+    last_registration = this;
+}
+
 featurless::test::test() {
     _data = new Data;
+    for (const registration* test = first_registration; test != nullptr; test = test->next)
+        _data->groups[add_group(test->group, test->function)._index].runs.back().test_name =
+          test->name;
 }
 
 featurless::test::~test() {
+    __write_baselines();
+    __teardown_fixtures(0);
     delete _data;
 }
 
+// with --update-baselines, writes the medians measured by check_perf once,
+// whether print_summary was called or not.
+void featurless::test::__write_baselines() {
+    if (!_data->update_baselines || _data->baseline_updates.empty())
+        return;
+    for (const auto& [key, median] : _data->baseline_updates)
+        _data->baselines.insert_or_assign(key, median);
+    if (write_baselines(_data->baselines_path, _data->baselines))
+        std::cout << "### BASELINES: " << _data->baseline_updates.size() << " written to '"
+                  << _data->baselines_path << "'\n";
+    else
+        std::cout << "Warning: could not write the baselines '" << _data->baselines_path
+                  << "'.\n";
+    _data->baseline_updates.clear();
+}
+
+void featurless::test::__add_fixture(const char* const name,
+                                     featurless::test::fixturefun_t* setup,
+                                     void* (*setup_thunk)(featurless::test::fixturefun_t*),
+                                     featurless::test::fixturefun_t* teardown,
+                                     void (*teardown_thunk)(featurless::test::fixturefun_t*,
+                                                            void*)) {
+    if (!_data->fixtures_index.emplace(name, _data->fixtures.size()).second)
+        return;
+    Fixture& fixture = _data->fixtures.emplace_back();
+    fixture.name = name;
+    fixture.setup = setup;
+    fixture.setup_thunk = setup_thunk;
+    fixture.teardown = teardown;
+    fixture.teardown_thunk = teardown_thunk;
+}
+
+const void* featurless::test::__fixture(const char* const name) {
+    const auto index = _data->fixtures_index.find(std::string_view(name));
+    if (index == _data->fixtures_index.end()) {
+        report(std::string("Warning: Unknown fixture '") + name + "'.\n");
+        return nullptr;
+    }
+    // the other threads asking for it wait for its setup
+    Fixture& fixture = _data->fixtures[index->second];
+    std::call_once(fixture.built, [&]() {
+        // shared by the groups, not allocated by the first one using it
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        const auto start = steady_clock::now();
+        fixture.object = fixture.setup_thunk(fixture.setup);
+        const int64_t setup_ns = elapsed_ns(start);
+        std::lock_guard<std::mutex> lock{ _data->results_mutex };
+        _data->built_fixtures.push_back(index->second);
+        _data->fixture_setups.emplace_back(index->second, setup_ns);
+    });
+    return fixture.object;
+}
+
+// in the reverse order of construction, a fixture may use the previous ones
+void featurless::test::__teardown_fixtures(unsigned long first) {
+    while (_data->built_fixtures.size() > first) {
+        Fixture& fixture = _data->fixtures[_data->built_fixtures.back()];
+        _data->built_fixtures.pop_back();
+        if (fixture.object != nullptr)
+            fixture.teardown_thunk(fixture.teardown, fixture.object);
+        fixture.object = nullptr;
+    }
+}
+
 void featurless::test::parse_args(int argc, const char** argv) {
     for (int i = 1; i < argc; ++i) {
         std::string_view current_arg{ argv[i] };
@@ -48,7 +749,35 @@ void featurless::test::parse_args(int argc, const char** argv) {
                  "\t-e, --enable  \tenable only the groups of tests whose name is provided\n"
                  "\t              \tafter this argument.\n"
                  "\t-d, --disable \tdisable only the groups of tests whose name is provided\n"
-                 "\t              \tafter this argument.\n";
+                 "\t              \tafter this argument.\n"
+                 "\t-j, --jobs    \tnumber of threads running the groups registered with a\n"
+                 "\t              \tfunction (0: one per core, default: 1).\n"
+                 "\t--isolate     \trun each group registered with a function in its own\n"
+                 "\t              \tprocess, up to -j processes at once.\n"
+                 "\t--timeout     \tseconds after which an isolated group is killed\n"
+                 "\t              \t(default: 0, never).\n"
+                 "\t--slowest     \tnumber of slowest groups and function checks printed\n"
+                 "\t              \tin the summary (default: 5).\n"
+                 "\t--report=format:path\n"
+                 "\t              \twrite a report of the tests in the file path, format\n"
+                 "\t              \tbeing json or junit. Can be repeated.\n"
+                 "\t--seed        \tseed of the property tests (default: random).\n"
+                 "\t--cases       \tnumber of cases of a property test (default: 10000).\n"
+                 "\t--shard-index \tindex of the shard to run, from 0 (default: 0).\n"
+                 "\t--shard-count \tnumber of shards the groups are split into (default: 1).\n"
+                 "\t--cache       \tsave the results of the groups next to the program, for\n"
+                 "\t              \tthe next runs.\n"
+                 "\t--failed-first\trun first the groups which failed in the previous run and\n"
+                 "\t              \tstop at the first group whose require fails (implies\n"
+                 "\t              \t--cache).\n"
+                 "\t--only-failed \trun only the groups which failed in the previous run\n"
+                 "\t              \t(implies --cache).\n"
+                 "\t--baselines   \tfile of the performance baselines (default: the program\n"
+                 "\t              \tpath followed by .baselines).\n"
+                 "\t--update-baselines\n"
+                 "\t              \twrite the measures of check_perf as the new baselines.\n"
+                 "\t--pmu         \tcount the cycles, instructions, branch and cache misses\n"
+                 "\t              \tof the benchmarks (linux perf_event_open).\n";
             _data->global_stats.status = StatusCode::help;
             break;
         } else if (current_arg == "-e" || current_arg == "--enabled") {
@@ -65,138 +794,1589 @@ void featurless::test::parse_args(int argc, const char** argv) {
                 _data->global_stats.status = StatusCode::argerror;
                 break;
             }
+        } else if (current_arg == "-j" || current_arg == "--jobs") {
+            unsigned jobs = 0;
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", jobs)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+            _data->jobs = jobs > 0 ? jobs : std::max(1U, std::thread::hardware_concurrency());
+        } else if (current_arg == "--isolate") {
+            _data->isolate = true;
+        } else if (current_arg == "--timeout") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->timeout)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--slowest") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->slowest)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--seed") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->seed)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--cases") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->property_cases)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--shard-index") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->shard_index)) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--shard-count") {
+            if (!parse_unsigned(i + 1 < argc ? argv[++i] : "", _data->shard_count)
+                || _data->shard_count == 0) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+        } else if (current_arg == "--cache") {
+            _data->use_cache = true;
+        } else if (current_arg == "--failed-first") {
+            _data->failed_first = true;
+            _data->use_cache = true;
+        } else if (current_arg == "--only-failed") {
+            _data->only_failed = true;
+            _data->use_cache = true;
+        } else if (current_arg == "--baselines") {
+            if (i + 1 >= argc) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+            _data->baselines_path = argv[++i];
+        } else if (current_arg == "--update-baselines") {
+            _data->update_baselines = true;
+        } else if (current_arg == "--pmu") {
+            _data->pmu = true;
+        } else if (current_arg.starts_with("--report=")) {
+            current_arg.remove_prefix(std::string_view("--report=").size());
+            const std::size_t separator = current_arg.find(':');
+            const std::string_view format = current_arg.substr(0, separator);
+            if (separator == std::string_view::npos || separator + 1 == current_arg.size()
+                || (format != "json" && format != "junit")) {
+                _data->global_stats.status = StatusCode::argerror;
+                break;
+            }
+            _data->reports.emplace_back(format, current_arg.substr(separator + 1));
         } else
             _data->filter_values.emplace_back(current_arg);
     }
+    if (_data->shard_index >= _data->shard_count)
+        _data->global_stats.status = StatusCode::argerror;
+    if (_data->use_cache && argc > 0) {
+        _data->cache_path = std::string(argv[0]) + ".featurless_cache";
+        read_cache(_data->cache_path, _data->cache);
+    }
+    if (_data->baselines_path.empty() && argc > 0)
+        _data->baselines_path = std::string(argv[0]) + ".baselines";
+    if (!_data->baselines_path.empty())
+        read_baselines(_data->baselines_path, _data->baselines);
+    // probed once, isolated children inherit the result
+    if (_data->pmu) {
+        HardwareCounters counters;
+        _data->pmu_notice = counters.open();
+        _data->pmu = _data->pmu_notice.empty();
+    }
+    for (Group& group : _data->groups)
+        group.enabled = _data->is_enabled(group.name);
+}
+
+featurless::test::group_handle featurless::test::add_group(const char* const group_name) {
+    const auto group = _data->groups_index.find(std::string_view(group_name));
+    if (group != _data->groups_index.end())
+        return group_handle(static_cast<long>(group->second));
+    if (_data->running) {
+        report(std::string("Warning: group '") + group_name
+               + "' added while run() is running, ignored.\n");
+        return group_handle();
+    }
+
+    _data->groups_index.emplace(group_name, _data->groups.size());
+    _data->groups.push_back({ group_name, _data->is_enabled(group_name), Stats(), {} });
+    return group_handle(static_cast<long>(_data->groups.size() - 1));
+}
+
+featurless::test::group_handle featurless::test::add_group(const char* const group_name,
+                                                           featurless::test::groupfun_t run) {
+    const group_handle group = add_group(group_name);
+    if (group._index >= 0 && !_data->running)
+        _data->groups[group._index].runs.push_back({ run, nullptr });
+    return group;
+}
+
+void featurless::test::set_timeout(const char* const group_name, unsigned seconds) {
+    const group_handle group = add_group(group_name);
+    if (group._index >= 0)
+        _data->groups[group._index].timeout = seconds;
+}
+
+featurless::test::group_handle featurless::test::__find_group(const char* const group_name) {
+    const auto group = _data->groups_index.find(std::string_view(group_name));
+    if (group == _data->groups_index.end()) {
+        report(std::string("Warning: Unknown group '") + group_name + "', skipped check.\n");
+        return group_handle(-1);
+    }
+    return group_handle(static_cast<long>(group->second));
 }
 
-void featurless::test::add_group(const char* const group_name) {
-    if (!_data->groups_stats.contains(group_name)) {
-        _data->groups_stats.insert({ group_name, Stats() });
+// The group is looked up again after each function: a function may still
+// call add_group, which must not invalidate what is used here.
+void featurless::test::__run_group(unsigned long group_index) {
+    Worker* const worker = current_worker;
+    _data->groups[group_index].ran = true;
+    const std::vector<GroupRun> runs = _data->groups[group_index].runs;
+    for (const GroupRun& run : runs) {
+        if (__stopped(static_cast<long>(group_index)))
+            break;
+        const auto allocations = featurless::alloc_tracker::thread_counters;
+        const auto start = steady_clock::now();
+        running_group = true;
+        running_test = run.test_name;
+        run.function(*this);
+        running_test = nullptr;
+        running_group = false;
+        Stats& stats =
+          worker != nullptr ? worker->groups[group_index] : _data->groups[group_index].stats;
+        stats.duration_ns += elapsed_ns(start);
+        stats.alloc_count += featurless::alloc_tracker::thread_counters.count - allocations.count;
+        stats.alloc_bytes += featurless::alloc_tracker::thread_counters.bytes - allocations.bytes;
+        if (worker != nullptr && !worker->output.empty()) {
+            std::lock_guard<std::mutex> lock{ _data->output_mutex };
+            std::cout << worker->output << std::flush;
+            worker->output.clear();
+        }
     }
+    const Stats& stats =
+      worker != nullptr ? worker->groups[group_index] : _data->groups[group_index].stats;
+    if (_data->failed_first && stats.status != StatusCode::ok)
+        _data->skip_pending.store(true, std::memory_order_relaxed);
 }
 
-inline bool featurless::test::__check(const char* const description, bool condition) {
+void featurless::test::run() {
     if (_data->global_stats.status != StatusCode::ok)
-        return false;
+        return;
+
+    // an empty cache (first run) knows no failure, then every group runs.
+    const auto failed = [this](const Group& group) {
+        const auto entry = _data->cache.find(std::string_view(group.name));
+        return entry != _data->cache.end() && entry->second.failed();
+    };
+    const bool any_failed =
+      std::any_of(_data->cache.begin(), _data->cache.end(),
+                  [](const auto& entry) { return entry.second.failed(); });
+    std::vector<unsigned long> pending;
+    for (std::size_t i = 0; i < _data->groups.size(); ++i) {
+        const Group& group = _data->groups[i];
+        if (!group.runs.empty() && group.enabled
+            && (!_data->only_failed || _data->cache.empty() || failed(group)))
+            pending.push_back(i);
+    }
+    if (_data->only_failed && !_data->cache.empty() && !any_failed)
+        std::cout << "No group failed in the previous run (--only-failed).\n";
+    // the previous failures first, the shortest first for a faster feedback.
+    if (_data->failed_first) {
+        std::stable_sort(pending.begin(), pending.end(), [&](unsigned long a, unsigned long b) {
+            const bool a_failed = failed(_data->groups[a]);
+            const bool b_failed = failed(_data->groups[b]);
+            if (a_failed != b_failed || !a_failed)
+                return a_failed;
+            return _data->cache.find(std::string_view(_data->groups[a].name))->second.duration_ns
+                   < _data->cache.find(std::string_view(_data->groups[b].name))->second.duration_ns;
+        });
+    }
+
+    _data->running = true;
+    __run_pending(pending.data(), pending.size());
+    _data->running = false;
+
+    const auto not_run = std::count_if(pending.begin(), pending.end(), [this](unsigned long i) {
+        return !_data->groups[i].ran;
+    });
+    if (not_run > 0)
+        std::cout << "A group failed (--failed-first), " << not_run << " group(s) did not run.\n";
+    if (_data->cache_path.empty())
+        return;
+    for (const Group& group : _data->groups) {
+        if (group.ran) {
+            _data->cache.insert_or_assign(
+              group.name, CacheEntry{ static_cast<signed char>(group.stats.status),
+                                      group.stats.count_checks - group.stats.count_success,
+                                      group.stats.duration_ns });
+        }
+    }
+    if (!write_cache(_data->cache_path, _data->cache))
+        std::cout << "Warning: could not write the results cache '" << _data->cache_path << "'.\n";
+}
+
+void featurless::test::__run_pending(const unsigned long* group_indexes, unsigned long count) {
+    if (_data->isolate) {
+        __run_isolated(group_indexes, count);
+        return;
+    }
+
+    const std::size_t nb_workers = std::min<std::size_t>(_data->jobs, count);
+    if (nb_workers <= 1) {
+        for (unsigned long i = 0; i < count && !_data->skip_pending.load(); ++i)
+            __run_group(group_indexes[i]);
+        return;
+    }
 
+    std::vector<Worker> workers(nb_workers);
+    std::vector<WorkQueue> queues(nb_workers);
+    // pushed backward: the owner takes its most recent task, the first ones
+    // start first.
+    for (std::size_t i = count; i-- > 0;)
+        queues[i % nb_workers].push(group_indexes[i]);
+
+    // no task is ever pushed once started: a worker stops when every queue is empty.
+    const auto work = [this, &workers, &queues](std::size_t worker_index) {
+        Worker& worker = workers[worker_index];
+        worker.groups.resize(_data->groups.size());
+        current_worker = &worker;
+        std::size_t task = 0;
+        for (;;) {
+            bool found = queues[worker_index].pop(task);
+            for (std::size_t i = 1; !found && i < queues.size(); ++i)
+                found = queues[(worker_index + i) % queues.size()].steal(task);
+            if (!found || _data->skip_pending.load(std::memory_order_relaxed))
+                break;
+            __run_group(task);
+        }
+        current_worker = nullptr;
+    };
+
+    std::vector<std::thread> threads;
+    threads.reserve(nb_workers - 1);
+    for (std::size_t i = 1; i < nb_workers; ++i)
+        threads.emplace_back(work, i);
+    work(0);
+    for (auto& thread : threads)
+        thread.join();
+
+    for (Worker& worker : workers) {
+        merge_stats(_data->global_stats, worker.global);
+        for (std::size_t i = 0; i < worker.groups.size(); ++i)
+            merge_stats(_data->groups[i].stats, worker.groups[i]);
+        std::move(worker.records.begin(), worker.records.end(), std::back_inserter(_data->records));
+        merge_slowest(_data->slowest_checks, _data->slowest, worker.slowest_checks);
+    }
+}
+
+void featurless::test::__fail_group(unsigned long group_index,
+                                    const char* const reason,
+                                    signed char status) {
+    Stats& stats = _data->groups[group_index].stats;
+    ++_data->global_stats.count_total;
     ++_data->global_stats.count_checks;
+    ++stats.count_checks;
+    stats.status = static_cast<StatusCode>(status);
+    _data->records.push_back({ static_cast<long>(group_index), reason, -1, false });
+    report_failure("(" + _data->groups[group_index].name + ") " + reason, line_width);
+}
+
+#if defined(FEATURLESS_TEST_FORK)
+void featurless::test::__run_isolated(const unsigned long* group_indexes, unsigned long count) {
+    using clock = std::chrono::steady_clock;
+    struct Child {
+        pid_t pid;
+        int fd;
+        unsigned long group;
+        clock::time_point start;
+        clock::time_point deadline;
+        bool timed_out;
+        bool done;
+        std::string received;
+        std::string output;
+        std::string result;
+    };
+
+    std::vector<Child> children;
+    unsigned long next = 0;
+    while (next < count || !children.empty()) {
+        while (children.size() < _data->jobs && next < count
+               && _data->global_stats.status == StatusCode::ok && !_data->skip_pending.load()) {
+            const unsigned long group_index = group_indexes[next++];
+            _data->groups[group_index].ran = true;
+            int fds[2]{ -1, -1 };
+            // the buffered output would be printed again by the child
+            std::cout.flush();
+            std::fflush(nullptr);
+            const pid_t pid = ::pipe(fds) == 0 ? ::fork() : -1;
+            if (pid == 0) {
+                ::close(fds[0]);
+                for (const Child& child : children)
+                    ::close(child.fd);
+                Worker worker;
+                worker.groups.resize(_data->groups.size());
+                worker.pipe = fds[1];
+                current_worker = &worker;
+                const std::size_t first_bench = _data->benchmarks.size();
+                const std::size_t first_baseline = _data->baseline_updates.size();
+                const std::size_t first_stress = _data->stress_results.size();
+                const std::size_t first_fixture = _data->built_fixtures.size();
+                const std::size_t first_setup = _data->fixture_setups.size();
+                __run_group(group_index);
+                __teardown_fixtures(first_fixture);
+
+                Message result;
+                result.put(worker.global);
+                for (std::size_t i = 0; i < worker.groups.size(); ++i) {
+                    if (worker.groups[i].count_checks > 0 || worker.groups[i].count_total > 0
+                        || worker.groups[i].duration_ns > 0
+                        || worker.groups[i].status != StatusCode::ok) {
+                        result.put(i);
+                        result.put(worker.groups[i]);
+                    }
+                }
+                result.put(static_cast<std::size_t>(-1));
+                result.put(_data->benchmarks.size() - first_bench);
+                for (std::size_t i = first_bench; i < _data->benchmarks.size(); ++i) {
+                    const BenchResult& bench = _data->benchmarks[i];
+                    result.put(std::string_view(bench.group));
+                    result.put(std::string_view(bench.description));
+                    result.put(bench.samples);
+                    result.put(bench.iterations);
+                    result.put(bench.min);
+                    result.put(bench.median);
+                    result.put(bench.mean);
+                    result.put(bench.stddev);
+                    result.put(bench.p99);
+                    for (const double counter : bench.counters)
+                        result.put(counter);
+                }
+                for (const auto* records : { &worker.records, &worker.slowest_checks }) {
+                    result.put(records->size());
+                    for (const CheckRecord& record : *records) {
+                        result.put(record.group);
+                        result.put(std::string_view(record.description));
+                        result.put(record.duration_ns);
+                        result.put(record.success);
+                    }
+                }
+                result.put(_data->baseline_updates.size() - first_baseline);
+                for (std::size_t i = first_baseline; i < _data->baseline_updates.size(); ++i) {
+                    result.put(std::string_view(_data->baseline_updates[i].first));
+                    result.put(_data->baseline_updates[i].second);
+                }
+                result.put(_data->stress_results.size() - first_stress);
+                for (std::size_t i = first_stress; i < _data->stress_results.size(); ++i) {
+                    const StressResult& stress = _data->stress_results[i];
+                    result.put(std::string_view(stress.group));
+                    result.put(std::string_view(stress.description));
+                    result.put(stress.iterations);
+                    result.put(stress.duration_ns);
+                    result.put(stress.failures.size());
+                    for (const uint64_t failures : stress.failures)
+                        result.put(failures);
+                }
+                // forked: the fixture indexes are the same in the parent
+                result.put(_data->fixture_setups.size() - first_setup);
+                for (std::size_t i = first_setup; i < _data->fixture_setups.size(); ++i) {
+                    result.put(_data->fixture_setups[i].first);
+                    result.put(_data->fixture_setups[i].second);
+                }
+                send_frame(fds[1], 'r', result.bytes());
+                ::close(fds[1]);
+                // _exit does not flush what the group printed itself
+                std::cout.flush();
+                std::fflush(nullptr);
+                ::_exit(0);
+            }
+            if (pid < 0) {
+                if (fds[0] >= 0) {
+                    ::close(fds[0]);
+                    ::close(fds[1]);
+                }
+                std::cout << "Warning: could not fork, group '" << _data->groups[group_index].name
+                          << "' runs in the main process.\n";
+                __run_group(group_index);
+                continue;
+            }
+            ::close(fds[1]);
+            const unsigned timeout = _data->groups[group_index].timeout > 0
+                                       ? _data->groups[group_index].timeout
+                                       : _data->timeout;
+            children.push_back({ pid, fds[0], group_index, clock::now(),
+                                 timeout > 0 ? clock::now() + std::chrono::seconds(timeout)
+                                             : clock::time_point::max(),
+                                 false, false, {}, {}, {} });
+        }
+        if (children.empty())
+            break;
+
+        // wait for some output or for the nearest deadline
+        std::vector<pollfd> polled;
+        clock::time_point deadline = clock::time_point::max();
+        for (const Child& child : children) {
+            polled.push_back({ child.fd, POLLIN, 0 });
+            if (!child.timed_out)
+                deadline = std::min(deadline, child.deadline);
+        }
+        int wait_ms = -1;
+        if (deadline != clock::time_point::max()) {
+            const auto remaining =
+              std::chrono::duration_cast<std::chrono::milliseconds>(deadline - clock::now())
+                .count();
+            wait_ms = static_cast<int>(std::clamp<long long>(remaining + 1, 0, 60000));
+        }
+        if (::poll(polled.data(), polled.size(), wait_ms) < 0 && errno != EINTR)
+            break;
+
+        const auto now = clock::now();
+        for (std::size_t i = 0; i < children.size(); ++i) {
+            Child& child = children[i];
+            if (polled[i].revents != 0) {
+                char buffer[4096];
+                const ssize_t size = ::read(child.fd, buffer, sizeof(buffer));
+                if (size > 0)
+                    child.received.append(buffer, static_cast<std::size_t>(size));
+                else if (size == 0 || errno != EINTR)
+                    child.done = true;
+            }
+            // unpack the complete frames
+            constexpr std::size_t header_size = 1 + sizeof(std::size_t);
+            while (child.received.size() >= header_size) {
+                std::size_t size = 0;
+                std::memcpy(&size, child.received.data() + 1, sizeof(size));
+                if (child.received.size() < header_size + size)
+                    break;
+                const std::string_view payload{ child.received.data() + header_size, size };
+                if (child.received[0] == 'o')
+                    child.output.append(payload);
+                else
+                    child.result.assign(payload);
+                child.received.erase(0, header_size + size);
+            }
+            if (!child.timed_out && !child.done && now >= child.deadline) {
+                ::kill(child.pid, SIGKILL);
+                child.timed_out = true;
+            }
+        }
+
+        for (auto child = children.begin(); child != children.end();) {
+            if (!child->done) {
+                ++child;
+                continue;
+            }
+            ::close(child->fd);
+            int status = 0;
+            while (::waitpid(child->pid, &status, 0) < 0 && errno == EINTR) {}
+
+            MessageReader reader{ child->result };
+            Stats stats;
+            std::size_t group_index = 0;
+            bool valid = !child->timed_out && WIFEXITED(status) && WEXITSTATUS(status) == 0
+                         && reader.get(stats);
+            if (valid) {
+                merge_stats(_data->global_stats, stats);
+                while ((valid = reader.get(group_index)) && group_index < _data->groups.size()
+                       && (valid = reader.get(stats)))
+                    merge_stats(_data->groups[group_index].stats, stats);
+                std::size_t nb_benchmarks = 0;
+                valid = valid && reader.get(nb_benchmarks);
+                for (std::size_t i = 0; valid && i < nb_benchmarks; ++i) {
+                    BenchResult bench;
+                    valid = reader.get(bench.group) && reader.get(bench.description)
+                            && reader.get(bench.samples) && reader.get(bench.iterations)
+                            && reader.get(bench.min) && reader.get(bench.median)
+                            && reader.get(bench.mean) && reader.get(bench.stddev)
+                            && reader.get(bench.p99);
+                    for (double& counter : bench.counters)
+                        valid = valid && reader.get(counter);
+                    if (valid)
+                        _data->benchmarks.push_back(std::move(bench));
+                }
+                // the failures, then the slowest successful checks
+                for (const bool failures : { true, false }) {
+                    std::size_t nb_records = 0;
+                    valid = valid && reader.get(nb_records);
+                    for (std::size_t i = 0; valid && i < nb_records; ++i) {
+                        CheckRecord record;
+                        valid = reader.get(record.group) && reader.get(record.description)
+                                && reader.get(record.duration_ns) && reader.get(record.success);
+                        if (valid && failures)
+                            _data->records.push_back(std::move(record));
+                        else if (valid)
+                            keep_slowest(_data->slowest_checks, _data->slowest, record.group,
+                                         record.description, record.duration_ns);
+                    }
+                }
+                std::size_t nb_baselines = 0;
+                valid = valid && reader.get(nb_baselines);
+                for (std::size_t i = 0; valid && i < nb_baselines; ++i) {
+                    std::pair<std::string, double> baseline;
+                    valid = reader.get(baseline.first) && reader.get(baseline.second);
+                    if (valid)
+                        _data->baseline_updates.push_back(std::move(baseline));
+                }
+                std::size_t nb_stress = 0;
+                valid = valid && reader.get(nb_stress);
+                for (std::size_t i = 0; valid && i < nb_stress; ++i) {
+                    StressResult stress;
+                    std::size_t nb_threads = 0;
+                    valid = reader.get(stress.group) && reader.get(stress.description)
+                            && reader.get(stress.iterations) && reader.get(stress.duration_ns)
+                            && reader.get(nb_threads);
+                    stress.failures.resize(valid ? nb_threads : 0);
+                    for (std::size_t j = 0; valid && j < nb_threads; ++j)
+                        valid = reader.get(stress.failures[j]);
+                    if (valid)
+                        _data->stress_results.push_back(std::move(stress));
+                }
+                std::size_t nb_setups = 0;
+                valid = valid && reader.get(nb_setups);
+                for (std::size_t i = 0; valid && i < nb_setups; ++i) {
+                    std::pair<std::size_t, int64_t> setup;
+                    valid = reader.get(setup.first) && reader.get(setup.second)
+                            && setup.first < _data->fixtures.size();
+                    if (valid)
+                        _data->fixture_setups.push_back(setup);
+                }
+            }
+
+            std::cout << child->output;
+            if (!valid || child->timed_out || WIFSIGNALED(status))
+                _data->groups[child->group].stats.duration_ns += elapsed_ns(child->start);
+            if (child->timed_out) {
+                const unsigned timeout = _data->groups[child->group].timeout > 0
+                                           ? _data->groups[child->group].timeout
+                                           : _data->timeout;
+                __fail_group(child->group,
+                             ("timed out after " + std::to_string(timeout) + "s").c_str(),
+                             static_cast<signed char>(StatusCode::timeout));
+            } else if (WIFSIGNALED(status)) {
+                __fail_group(child->group,
+                             ("crashed with signal " + std::to_string(WTERMSIG(status)) + " ("
+                              + strsignal(WTERMSIG(status)) + ")")
+                               .c_str(),
+                             static_cast<signed char>(StatusCode::crashed));
+            } else if (!valid) {
+                __fail_group(child->group,
+                             ("exited with code " + std::to_string(WEXITSTATUS(status))).c_str(),
+                             static_cast<signed char>(StatusCode::crashed));
+            }
+            if (_data->failed_first && _data->groups[child->group].stats.status != StatusCode::ok)
+                _data->skip_pending.store(true);
+            child = children.erase(child);
+        }
+    }
+}
+#else
+void featurless::test::__run_isolated(const unsigned long* group_indexes, unsigned long count) {
+    std::cout << "Warning: --isolate is not supported on this platform, groups run in the main "
+                 "process.\n";
+    for (unsigned long i = 0; i < count && !_data->skip_pending.load(); ++i)
+        __run_group(group_indexes[i]);
+}
+#endif
+
+// true if the checks of the group (or the global ones if group_index is -1)
+// are not performed anymore because a require failed.
+bool featurless::test::__stopped(long group_index) {
+    if (_data->global_stats.status != StatusCode::ok
+        || local_stats(_data->global_stats).status != StatusCode::ok
+        || _data->stopped.load(std::memory_order_relaxed))
+        return true;
+    if (group_index < 0)
+        return false;
+    return _data->groups[group_index].stats.status != StatusCode::ok
+           || (current_worker != nullptr
+               && current_worker->groups[group_index].status != StatusCode::ok);
+}
+
+inline bool featurless::test::__check(const char* const description,
+                                      bool condition,
+                                      long long duration_ns) {
+    if (__stopped(-1))
+        return false;
+    if (!_data->global_enabled())
+        return condition;
+
+    Stats& global_stats = local_stats(_data->global_stats);
+    ++global_stats.count_checks;
     if (condition) {
-        ++_data->global_stats.count_success;
+        ++global_stats.count_success;
+        if (duration_ns >= 0)
+            keep_slowest(current_worker != nullptr ? current_worker->slowest_checks
+                                                   : _data->slowest_checks,
+                         _data->slowest, -1, description, duration_ns);
     } else
-        std::cout << std::left << std::setfill('.') << std::setw(line_width) << description
-                  << "Failure\n";
+        record_failure(_data->records, -1, description, duration_ns, line_width);
+    if (duration_ns > 0 && !running_group)
+        global_stats.duration_ns += duration_ns;
 
     return condition;
 }
 
 inline bool featurless::test::__check(const char* const description,
-                                      const char* const group_name,
-                                      bool condition) {
-    Stats& stats = _data->groups_stats[group_name];
-    if (_data->global_stats.status != StatusCode::ok || stats.status != StatusCode::ok)
+                                      long group_index,
+                                      bool condition,
+                                      long long duration_ns) {
+    if (__stopped(group_index))
         return false;
 
+    Stats& global_stats = local_stats(_data->global_stats);
+    Stats& stats = current_worker != nullptr ? current_worker->groups[group_index]
+                                             : _data->groups[group_index].stats;
     ++stats.count_checks;
-    ++_data->global_stats.count_checks;
+    ++global_stats.count_checks;
     if (condition) {
         ++stats.count_success;
-        ++_data->global_stats.count_success;
+        ++global_stats.count_success;
+        if (duration_ns >= 0)
+            keep_slowest(current_worker != nullptr ? current_worker->slowest_checks
+                                                   : _data->slowest_checks,
+                         _data->slowest, group_index, description, duration_ns);
     } else
-        std::cout << std::left << std::setfill('.') << std::setw(line_width) << description
-                  << "Failure\n";
+        record_failure(_data->records, group_index, description, duration_ns, line_width);
+    if (duration_ns > 0 && !running_group)
+        stats.duration_ns += duration_ns;
 
     return condition;
 }
 
+void featurless::test::__require_failed() {
+    if (_data->global_stats.status != StatusCode::ok)
+        return;
+    if (current_worker != nullptr) {
+        current_worker->global.status = StatusCode::requirefail;
+        _data->stopped.store(true, std::memory_order_relaxed);
+    } else
+        _data->global_stats.status = StatusCode::requirefail;
+}
+
+void featurless::test::__group_require_failed(long group_index) {
+    if (current_worker != nullptr)
+        current_worker->groups[group_index].status = StatusCode::requirefail;
+    else
+        _data->groups[group_index].stats.status = StatusCode::requirefail;
+}
+
 void featurless::test::check(const char* const description, bool condition) {
-    ++_data->global_stats.count_total;
+    ++local_stats(_data->global_stats).count_total;
     __check(description, condition);
 }
 
 void featurless::test::require(const char* const description, bool condition) {
-    ++_data->global_stats.count_total;
+    ++local_stats(_data->global_stats).count_total;
     bool success = __check(description, condition);
-    if (!success && _data->global_stats.status != StatusCode::help)
-        _data->global_stats.status = StatusCode::requirefail;
+    if (!success)
+        __require_failed();
 }
 
-void featurless::test::check(const char* const description, featurless::test::testfun_t condition) {
-    ++_data->global_stats.count_total;
-    __check(description, condition());
+void featurless::test::__check_function(const char* const description,
+                                        featurless::test::testfun_t condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (__stopped(-1))
+        return;
+    const auto start = steady_clock::now();
+    const bool success = condition();
+    __check(description, success, elapsed_ns(start));
 }
 
-void featurless::test::require(const char* const description,
-                               featurless::test::testfun_t condition) {
-    ++_data->global_stats.count_total;
-    bool success = __check(description, condition());
-    if (!success && _data->global_stats.status != StatusCode::help)
-        _data->global_stats.status = StatusCode::requirefail;
+void featurless::test::__require_function(const char* const description,
+                                          featurless::test::testfun_t condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (__stopped(-1))
+        return;
+    const auto start = steady_clock::now();
+    const bool success = condition();
+    if (!__check(description, success, elapsed_ns(start)))
+        __require_failed();
 }
 
-bool featurless::test::is_group_enabled(const char* const group_name) {
-    if (!_data->groups_stats.contains(group_name)) {
-        std::cout << "Warning: Unknown group '" << group_name << "', skipped check.\n";
-        return false;
-    }
-
-    if (_data->filter_type == FilterType::none)
-        return true;
-    if (_data->groups_stats[group_name].status != StatusCode::ok)
-        return false;
-
-    const auto value =
-      std::find(_data->filter_values.cbegin(), _data->filter_values.cend(), group_name);
+void featurless::test::check(featurless::test::group_handle group,
+                             const char* const description,
+                             bool condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index >= 0 && _data->groups[group._index].enabled)
+        __check(description, group._index, condition);
+}
 
-    return (_data->filter_type == FilterType::disabled && value == _data->filter_values.cend())
-           || (_data->filter_type == FilterType::enabled && value != _data->filter_values.cend());
+void featurless::test::require(featurless::test::group_handle group,
+                               const char* const description,
+                               bool condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index >= 0 && _data->groups[group._index].enabled) {
+        bool success = __check(description, group._index, condition);
+        if (!success)
+            __group_require_failed(group._index);
+    }
 }
 
 void featurless::test::check(const char* const group_name,
                              const char* const description,
                              bool condition) {
-    ++_data->global_stats.count_total;
-    if (is_group_enabled(group_name))
-        __check(description, group_name, condition);
+    check(__find_group(group_name), description, condition);
 }
 
 void featurless::test::require(const char* const group_name,
                                const char* const description,
                                bool condition) {
-    ++_data->global_stats.count_total;
-    if (is_group_enabled(group_name)) {
-        bool success = __check(description, group_name, condition);
-        if (!success)
-            _data->groups_stats[group_name].status = StatusCode::requirefail;
+    require(__find_group(group_name), description, condition);
+}
+
+void featurless::test::__check_function(featurless::test::group_handle group,
+                                        const char* const description,
+                                        featurless::test::testfun_t condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+    const auto start = steady_clock::now();
+    const bool success = condition();
+    __check(description, group._index, success, elapsed_ns(start));
+}
+
+void featurless::test::__require_function(featurless::test::group_handle group,
+                                          const char* const description,
+                                          featurless::test::testfun_t condition) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+    const auto start = steady_clock::now();
+    const bool success = condition();
+    if (!__check(description, group._index, success, elapsed_ns(start)))
+        __group_require_failed(group._index);
+}
+
+void featurless::test::__check_property(featurless::test::group_handle group,
+                                        const char* const description,
+                                        featurless::test::property_runner& property) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+
+    // every case has its own seed, derived from the run seed and its index,
+    // so that a failing case can be generated again alone.
+    const uint64_t seed = _data->seed;
+    const auto case_seed = [seed](uint64_t index) {
+        return featurless::gen::rng{ seed + index }.next();
+    };
+    const uint64_t nb_cases = _data->property_cases;
+    std::atomic<uint64_t> next_case{ 0 };
+    std::atomic<uint64_t> first_failure{ nb_cases };
+    const auto work = [&]() {
+        for (uint64_t index = next_case.fetch_add(1, std::memory_order_relaxed);
+             index < first_failure.load(std::memory_order_relaxed);
+             index = next_case.fetch_add(1, std::memory_order_relaxed)) {
+            if (property.run(case_seed(index)))
+                continue;
+            uint64_t failure = first_failure.load(std::memory_order_relaxed);
+            while (index < failure && !first_failure.compare_exchange_weak(failure, index)) {}
+        }
+    };
+
+    const auto start = steady_clock::now();
+    // the -j workers already share the cores, a property only takes its part
+    unsigned cores = std::max(1U, std::thread::hardware_concurrency());
+    if (current_worker != nullptr)
+        cores = std::max(1U, cores / std::max(1U, _data->jobs));
+    const auto nb_threads = static_cast<unsigned>(std::min<uint64_t>(cores, nb_cases));
+    std::vector<std::thread> threads;
+    {
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        threads.reserve(nb_threads);
+        for (unsigned i = 1; i < nb_threads; ++i)
+            threads.emplace_back(work);
     }
+    work();
+    for (auto& thread : threads)
+        thread.join();
+
+    // the smallest failing index is kept, the result does not depend on the
+    // number of threads
+    const uint64_t failure = first_failure.load();
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    std::string counterexample;
+    if (failure < nb_cases)
+        counterexample = property.shrink(case_seed(failure));
+    if (!__check(description, group._index, failure == nb_cases, elapsed_ns(start)))
+        report("    counterexample " + counterexample + ", case " + std::to_string(failure)
+               + " of --seed " + std::to_string(seed) + '\n');
 }
 
-void featurless::test::check(const char* const group_name,
-                             const char* const description,
-                             featurless::test::testfun_t condition) {
-    ++_data->global_stats.count_total;
-    if (is_group_enabled(group_name))
-        __check(description, group_name, condition());
+void featurless::test::__check_alloc(featurless::test::group_handle group,
+                                     const char* const description,
+                                     featurless::function_ref<void()> function,
+                                     unsigned long long max_count,
+                                     unsigned long long max_bytes,
+                                     bool required) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+    // without the tracker nothing is counted, passing would hide regressions
+    if (!featurless::alloc_tracker::installed) {
+        __check(description, group._index, false);
+        report("    allocations are not tracked, link featurless::ftest_alloc\n");
+        if (required)
+            __group_require_failed(group._index);
+        return;
+    }
+
+    // only the allocations of the calling thread are counted
+    const auto before = featurless::alloc_tracker::thread_counters;
+    const auto start = steady_clock::now();
+    function();
+    const long long duration = elapsed_ns(start);
+    const uint64_t count = featurless::alloc_tracker::thread_counters.count - before.count;
+    const uint64_t bytes = featurless::alloc_tracker::thread_counters.bytes - before.bytes;
+    if (!running_group) {
+        Stats& stats = current_worker != nullptr ? current_worker->groups[group._index]
+                                                 : _data->groups[group._index].stats;
+        stats.alloc_count += count;
+        stats.alloc_bytes += bytes;
+    }
+    if (!__check(description, group._index, count <= max_count && bytes <= max_bytes, duration)) {
+        report("    " + std::to_string(count) + " allocation(s) of " + std::to_string(bytes)
+               + " bytes, at most " + std::to_string(max_count) + " of " + std::to_string(max_bytes)
+               + " bytes expected\n");
+        if (required)
+            __group_require_failed(group._index);
+    }
 }
 
-void featurless::test::require(const char* const group_name,
+// random yields of the stress threads, 0: disabled on this thread
+static thread_local uint64_t yield_state{ 0 };
+
+void featurless::test::yield_point() noexcept {
+    if (yield_state == 0)
+        return;
+    // xorshift64, one point out of 8 yields
+    yield_state ^= yield_state << 13U;
+    yield_state ^= yield_state >> 7U;
+    yield_state ^= yield_state << 17U;
+    if ((yield_state & 7U) == 0)
+        std::this_thread::yield();
+}
+
+void featurless::test::__stress(featurless::test::group_handle group,
+                                const char* const description,
+                                unsigned nb_threads,
+                                unsigned long long iterations,
+                                featurless::test::stressfun_t function,
+                                unsigned flags) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+    nb_threads = std::max(1U, nb_threads);
+    // the function runs on the stress threads, this one only does bookkeeping
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+
+    // each thread checks in its own worker, merged in the calling thread's
+    // context once they are done.
+    std::vector<Worker> workers(nb_threads);
+    std::vector<uint64_t> failures(nb_threads, 0);
+    std::atomic<unsigned> ready{ 0 };
+    const bool caller_in_group = running_group;
+#if defined(__linux__)
+    // the cores allowed by the affinity mask (cpuset of a container...)
+    std::vector<int> cores;
+    std::atomic<unsigned> pin_failures{ 0 };
+    if ((flags & stress_pin) != 0) {
+        cpu_set_t allowed;
+        CPU_ZERO(&allowed);
+        if (sched_getaffinity(0, sizeof(allowed), &allowed) == 0) {
+            for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+                if (CPU_ISSET(cpu, &allowed))
+                    cores.push_back(cpu);
+            }
+        }
+    }
+#endif
+    const auto stress_thread = [&](unsigned index) {
+        Worker& worker = workers[index];
+        worker.groups.resize(_data->groups.size());
+        current_worker = &worker;
+        running_group = caller_in_group;
+        yield_state = (flags & stress_yield) != 0 ? 0x9e3779b97f4a7c15ULL * (index + 1) : 0;
+#if defined(__linux__)
+        if ((flags & stress_pin) != 0) {
+            cpu_set_t cpus;
+            CPU_ZERO(&cpus);
+            if (!cores.empty())
+                CPU_SET(cores[index % cores.size()], &cpus);
+            if (cores.empty() || pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+                pin_failures.fetch_add(1, std::memory_order_relaxed);
+        }
+#endif
+        // spin barrier: the threads start together instead of one after the
+        // other, as a condition variable wakeup would let them.
+        ready.fetch_add(1, std::memory_order_acq_rel);
+        for (unsigned spins = 0; ready.load(std::memory_order_acquire) < nb_threads; ++spins) {
+            if (spins % 1024 == 1023)
+                std::this_thread::yield();
+        }
+        // counted locally, the counters of the threads share a cache line
+        uint64_t thread_failures = 0;
+        for (unsigned long long i = 0; i < iterations; ++i) {
+            bool success = false;
+            try {
+                success = function(index, i);
+            } catch (...) {
+            }
+            thread_failures += success ? 0 : 1;
+            if ((flags & stress_yield) != 0)
+                yield_point();
+        }
+        failures[index] = thread_failures;
+        yield_state = 0;
+        running_group = false;
+        current_worker = nullptr;
+    };
+
+    const auto start = steady_clock::now();
+    std::vector<std::thread> threads;
+    threads.reserve(nb_threads);
+    for (unsigned i = 0; i < nb_threads; ++i)
+        threads.emplace_back(stress_thread, i);
+    for (auto& thread : threads)
+        thread.join();
+    const long long duration = elapsed_ns(start);
+#if defined(__linux__)
+    if (pin_failures.load() > 0)
+        report("Warning: " + std::to_string(pin_failures.load()) + " thread(s) of stress '"
+               + description + "' could not be pinned.\n");
+    else if ((flags & stress_pin) != 0 && cores.size() < nb_threads)
+        report("Warning: stress '" + std::string(description) + "' has more threads than the "
+               + std::to_string(cores.size()) + " allowed core(s), some of them share one.\n");
+#else
+    if ((flags & stress_pin) != 0)
+        report("Warning: stress_pin is only supported on linux, the threads of stress '"
+               + std::string(description) + "' are not pinned.\n");
+#endif
+
+    for (Worker& worker : workers) {
+        if (current_worker != nullptr) {
+            merge_stats(current_worker->global, worker.global);
+            for (std::size_t i = 0; i < worker.groups.size(); ++i)
+                merge_stats(current_worker->groups[i], worker.groups[i]);
+            std::move(worker.records.begin(), worker.records.end(),
+                      std::back_inserter(current_worker->records));
+            merge_slowest(current_worker->slowest_checks, _data->slowest, worker.slowest_checks);
+        } else {
+            merge_stats(_data->global_stats, worker.global);
+            for (std::size_t i = 0; i < worker.groups.size(); ++i)
+                merge_stats(_data->groups[i].stats, worker.groups[i]);
+            std::move(worker.records.begin(), worker.records.end(),
+                      std::back_inserter(_data->records));
+            merge_slowest(_data->slowest_checks, _data->slowest, worker.slowest_checks);
+        }
+        if (!worker.output.empty())
+            report(worker.output);
+    }
+
+    uint64_t nb_failures = 0;
+    std::string per_thread;
+    for (const uint64_t thread_failures : failures) {
+        nb_failures += thread_failures;
+        per_thread += (per_thread.empty() ? "" : ", ") + std::to_string(thread_failures);
+    }
+    if (!__check(description, group._index, nb_failures == 0, duration))
+        report("    " + std::to_string(nb_failures) + " failure(s), per thread: " + per_thread
+               + '\n');
+    std::lock_guard<std::mutex> lock{ _data->results_mutex };
+    _data->stress_results.push_back({ _data->groups[group._index].name, description, iterations,
+                                      duration, std::move(failures) });
+}
+
+featurless::test::__operand::__operand(bool value) noexcept
+    : _kind{ boolean }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(char value) noexcept
+    : _kind{ character }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(signed char value) noexcept
+    : _kind{ signed_int }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(unsigned char value) noexcept
+    : _kind{ unsigned_int }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(short value) noexcept
+    : _kind{ signed_int }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(unsigned short value) noexcept
+    : _kind{ unsigned_int }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(int value) noexcept
+    : _kind{ signed_int }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(unsigned int value) noexcept
+    : _kind{ unsigned_int }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(long value) noexcept
+    : _kind{ signed_int }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(unsigned long value) noexcept
+    : _kind{ unsigned_int }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(long long value) noexcept
+    : _kind{ signed_int }
+    , _signed{ value } {}
+featurless::test::__operand::__operand(unsigned long long value) noexcept
+    : _kind{ unsigned_int }
+    , _unsigned{ value } {}
+featurless::test::__operand::__operand(float value) noexcept
+    : _kind{ floating }
+    , _floating{ value } {}
+featurless::test::__operand::__operand(double value) noexcept
+    : _kind{ floating }
+    , _floating{ value } {}
+featurless::test::__operand::__operand(long double value) noexcept
+    : _kind{ floating }
+    , _floating{ static_cast<double>(value) } {}
+featurless::test::__operand::__operand(const void* value) noexcept
+    : _kind{ pointer }
+    , _pointer{ value } {}
+featurless::test::__operand::__operand(const char* value) noexcept
+    : _kind{ value != nullptr ? chars : pointer }
+    , _chars{ value }
+    , _size{ value != nullptr ? std::strlen(value) : 0 } {}
+featurless::test::__operand::__operand(const char* data, unsigned long size) noexcept
+    : _kind{ chars }
+    , _chars{ data }
+    , _size{ size } {}
+
+// Quoted and escaped strings, cut after 256 characters: a failure message
+// stays readable.
+static void append_quoted(std::string& text, std::string_view value, char quote) {
+    constexpr std::size_t max_size{ 256 };
+    text += quote;
+    for (const char c : value.substr(0, max_size)) {
+        if (c == quote || c == '\\') {
+            text += '\\';
+            text += c;
+        } else if (c == '\n')
+            text += "\\n";
+        else if (c == '\t')
+            text += "\\t";
+        else if (static_cast<unsigned char>(c) < 0x20 || c == 0x7f) {
+            constexpr char hex[]{ "0123456789abcdef" };
+            text += "\\x";
+            text += hex[(static_cast<unsigned char>(c) >> 4U) & 0xfU];
+            text += hex[static_cast<unsigned char>(c) & 0xfU];
+        } else
+            text += c;
+    }
+    text += quote;
+    if (value.size() > max_size)
+        text += "... (" + std::to_string(value.size()) + " characters)";
+}
+
+bool featurless::test::__equal_chars(const char* a, const char* b) noexcept {
+    if (a == nullptr || b == nullptr)
+        return a == b;
+    return std::strcmp(a, b) == 0;
+}
+
+void featurless::test::__compare_failed(featurless::test::group_handle group,
+                                        const char* const description,
+                                        const featurless::test::__operand& a,
+                                        const char* const comparison,
+                                        const featurless::test::__operand& b,
+                                        const featurless::test::__operand& tolerance) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+    __check(description, group._index, false);
+    // the operands are formatted here only, a passing check never pays for it
+    const auto format = [](const __operand& operand) -> std::string {
+        char buffer[64];
+        const auto print = [&buffer](auto value, auto... base) {
+            const auto result = std::to_chars(buffer, buffer + sizeof(buffer), value, base...);
+            return std::string(buffer, result.ptr);
+        };
+        std::string text;
+        switch (operand._kind) {
+            case __operand::boolean: return operand._unsigned != 0 ? "true" : "false";
+            case __operand::character:
+                buffer[0] = static_cast<char>(operand._signed);
+                append_quoted(text, std::string_view(buffer, 1), '\'');
+                return text + " (" + std::to_string(operand._signed) + ')';
+            case __operand::signed_int: return print(operand._signed);
+            case __operand::unsigned_int: return print(operand._unsigned);
+            case __operand::floating: return print(operand._floating);
+            case __operand::pointer:
+                if (operand._pointer == nullptr)
+                    return "nullptr";
+                return "0x" + print(reinterpret_cast<std::uintptr_t>(operand._pointer), 16);
+            case __operand::chars:
+                append_quoted(text, std::string_view(operand._chars, operand._size), '"');
+                return text;
+            case __operand::none: break;
+        }
+        return "(not printable)";
+    };
+    std::string message = "    " + format(a) + ' ' + comparison + ' ' + format(b);
+    if (tolerance._kind != __operand::none)
+        message += " (tolerance " + format(tolerance) + ')';
+    report(message + " is false\n");
+}
+
+// written through a volatile pointer, the compiler must assume it is read.
+static const volatile void* volatile escape_sink{ nullptr };
+
+void featurless::test::__escape(const volatile void* pointer) noexcept {
+    escape_sink = pointer;
+}
+
+// Sorted ns per iteration of each sample, shared by bench and check_perf. The
+// hardware counters, if any, count the samples only.
+static std::vector<double> take_samples(void* context,
+                                        void (*loop)(void*, unsigned long long),
+                                        uint64_t& iterations,
+                                        HardwareCounters* counters = nullptr,
+                                        double (*per_iteration)[nb_counters] = nullptr) {
+    using clock = std::chrono::steady_clock;
+    constexpr std::chrono::nanoseconds warmup_time{ std::chrono::milliseconds(50) };
+    constexpr std::chrono::nanoseconds sample_time{ std::chrono::milliseconds(5) };
+    constexpr std::size_t max_samples{ 100 };
+    constexpr std::size_t min_samples{ 5 };
+    // a body folded by the compiler takes no time, its iterations are capped
+    // instead of doubled until they overflow
+    constexpr uint64_t max_iterations{ 1ULL << 30U };
+
+    // warm up caches and branch predictors, doubling the iterations until the
+    // warmup time is reached. The last run gives the cost of one iteration.
+    iterations = 1;
+    std::chrono::nanoseconds elapsed{ 0 };
+    for (;;) {
+        const auto start = clock::now();
+        loop(context, iterations);
+        elapsed = clock::now() - start;
+        if (elapsed >= warmup_time || iterations >= max_iterations)
+            break;
+        iterations *= 2;
+    }
+
+    // slow functions get fewer samples of one iteration instead of endless runs
+    std::size_t nb_samples = max_samples;
+    if (elapsed.count() <= 0) {
+        // below the timer resolution
+        iterations = max_iterations;
+    } else {
+        const double iteration_ns =
+          static_cast<double>(elapsed.count()) / static_cast<double>(iterations);
+        iterations = static_cast<uint64_t>(
+          std::min(static_cast<double>(sample_time.count()) / iteration_ns,
+                   static_cast<double>(max_iterations)));
+        if (iterations == 0) {
+            iterations = 1;
+            nb_samples = std::clamp<std::size_t>(
+              static_cast<std::size_t>(static_cast<double>(max_samples * sample_time.count())
+                                       / iteration_ns),
+              min_samples, max_samples);
+        }
+    }
+
+    std::vector<double> samples;
+    {
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        samples.resize(nb_samples);
+    }
+    if (counters != nullptr)
+        counters->start();
+    for (double& sample : samples) {
+        const auto start = clock::now();
+        loop(context, iterations);
+        const std::chrono::nanoseconds duration = clock::now() - start;
+        sample = static_cast<double>(duration.count()) / static_cast<double>(iterations);
+    }
+    if (counters != nullptr)
+        counters->stop(iterations * nb_samples, *per_iteration);
+    std::sort(samples.begin(), samples.end());
+    return samples;
+}
+
+// of sorted values
+static double median_of(const std::vector<double>& values) noexcept {
+    const std::size_t size = values.size();
+    return size % 2 == 1 ? values[size / 2] : (values[size / 2 - 1] + values[size / 2]) / 2;
+}
+
+void featurless::test::__bench(featurless::test::group_handle group,
                                const char* const description,
-                               featurless::test::testfun_t condition) {
-    ++_data->global_stats.count_total;
-    if (is_group_enabled(group_name)) {
-        bool success = __check(description, group_name, condition());
-        if (!success)
-            _data->groups_stats[group_name].status = StatusCode::requirefail;
+                               void* context,
+                               featurless::test::benchfun_t loop) {
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+
+    uint64_t iterations = 0;
+    BenchResult result{ _data->groups[group._index].name, description, 0, 0, 0, 0, 0, 0, 0 };
+    HardwareCounters counters;
+    const bool counted = _data->pmu && counters.open().empty();
+    const std::vector<double> samples = take_samples(
+      context, loop, iterations, counted ? &counters : nullptr, &result.counters);
+    const featurless::alloc_tracker::suspend_counting bookkeeping;
+    const std::size_t nb_samples = samples.size();
+    result.samples = nb_samples;
+    result.iterations = iterations;
+    result.min = samples.front();
+    result.median = median_of(samples);
+    double sum = 0;
+    for (const double sample : samples)
+        sum += sample;
+    result.mean = sum / static_cast<double>(nb_samples);
+    double variance = 0;
+    for (const double sample : samples)
+        variance += (sample - result.mean) * (sample - result.mean);
+    result.stddev = std::sqrt(variance / static_cast<double>(nb_samples - 1));
+    result.p99 =
+      samples[static_cast<std::size_t>(std::ceil(0.99 * static_cast<double>(nb_samples))) - 1];
+
+    std::lock_guard<std::mutex> lock{ _data->results_mutex };
+    _data->benchmarks.push_back(std::move(result));
+}
+
+// Median of the samples once the outliers (preemptions, page faults...) are
+// rejected, and the noise of this median: 3 standard errors, estimated from
+// the median absolute deviation which the outliers do not inflate.
+struct PerfMeasure {
+    double median;
+    double noise;
+};
+
+static PerfMeasure measure_perf(void* context, void (*loop)(void*, unsigned long long)) {
+    constexpr double mad_to_sigma{ 1.4826 };       // for normally distributed samples
+    constexpr double median_standard_error{ 1.2533 };  // sigma / sqrt(n) units
+    uint64_t iterations = 0;
+    std::vector<double> samples = take_samples(context, loop, iterations);
+    const auto deviation = [](const std::vector<double>& values, double median) {
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        std::vector<double> deviations;
+        deviations.reserve(values.size());
+        for (const double value : values)
+            deviations.push_back(std::abs(value - median));
+        std::sort(deviations.begin(), deviations.end());
+        return median_of(deviations) * mad_to_sigma;
+    };
+
+    double median = median_of(samples);
+    const double sigma = deviation(samples, median);
+    if (sigma > 0) {
+        std::erase_if(samples,
+                      [&](double sample) { return std::abs(sample - median) > 3 * sigma; });
+        median = median_of(samples);
     }
+    const double noise = 3 * median_standard_error * deviation(samples, median)
+                         / std::sqrt(static_cast<double>(samples.size()));
+    return { median, noise };
+}
+
+void featurless::test::__check_perf(featurless::test::group_handle group,
+                                    const char* const description,
+                                    void* context,
+                                    featurless::test::benchfun_t loop,
+                                    double tolerance) {
+    ++local_stats(_data->global_stats).count_total;
+    if (group._index < 0 || !_data->groups[group._index].enabled || __stopped(group._index))
+        return;
+
+    std::string key;
+    {
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        key = _data->groups[group._index].name + '\t' + description;
+    }
+    const auto start = steady_clock::now();
+    PerfMeasure measure = measure_perf(context, loop);
+    if (_data->update_baselines) {
+        {
+            const featurless::alloc_tracker::suspend_counting bookkeeping;
+            std::lock_guard<std::mutex> lock{ _data->results_mutex };
+            _data->baseline_updates.emplace_back(key, measure.median);
+        }
+        __check(description, group._index, true, elapsed_ns(start));
+        return;
+    }
+
+    // the baselines are only written by print_summary, read without lock
+    const auto baseline = _data->baselines.find(key);
+    if (baseline == _data->baselines.end()) {
+        __check(description, group._index, true, elapsed_ns(start));
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        report(std::string("Warning: no baseline for '") + description
+               + "', run with --update-baselines.\n");
+        return;
+    }
+    // slower than the tolerance allows, beyond the noise of the measure. A
+    // regression is measured again once, so that a load peak does not fail.
+    const double limit = baseline->second * (1 + tolerance);
+    if (measure.median - measure.noise > limit) {
+        const PerfMeasure again = measure_perf(context, loop);
+        if (again.median < measure.median)
+            measure = again;
+    }
+    if (!__check(description, group._index, measure.median - measure.noise <= limit,
+                 elapsed_ns(start))) {
+        const featurless::alloc_tracker::suspend_counting bookkeeping;
+        std::ostringstream message;
+        message << std::fixed << std::setprecision(2) << "    median " << measure.median
+                << " ns (+/- " << measure.noise << "), baseline " << baseline->second << " ns, +"
+                << (measure.median / baseline->second - 1) * 100 << "% for a tolerance of "
+                << tolerance * 100 << "%\n";
+        report(message.str());
+    }
+}
+
+static const char* status_name(StatusCode status) noexcept {
+    switch (status) {
+        case StatusCode::ok: return "ok";
+        case StatusCode::help: return "help";
+        case StatusCode::argerror: return "argerror";
+        case StatusCode::requirefail: return "requirefail";
+        case StatusCode::crashed: return "crashed";
+        case StatusCode::timeout: return "timeout";
+    }
+    return "unknown";
+}
+
+static std::string json_escape(const std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size() + 2);
+    escaped += '"';
+    for (const char c : value) {
+        switch (c) {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\r': escaped += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20) {
+                    constexpr char digits[] = "0123456789abcdef";
+                    escaped += "\\u00";
+                    escaped += digits[(c >> 4) & 0xf];
+                    escaped += digits[c & 0xf];
+                } else
+                    escaped += c;
+        }
+    }
+    escaped += '"';
+    return escaped;
+}
+
+static std::string xml_escape(const std::string_view value) {
+    std::string escaped;
+    escaped.reserve(value.size());
+    for (const char c : value) {
+        switch (c) {
+            case '&': escaped += "&amp;"; break;
+            case '<': escaped += "&lt;"; break;
+            case '>': escaped += "&gt;"; break;
+            case '"': escaped += "&quot;"; break;
+            case '\'': escaped += "&apos;"; break;
+            default:
+                if (static_cast<unsigned char>(c) >= 0x20 || c == '\n' || c == '\t')
+                    escaped += c;
+        }
+    }
+    return escaped;
+}
+
+static double to_seconds(int64_t duration_ns) noexcept {
+    return static_cast<double>(duration_ns) / 1e9;
+}
+
+void featurless::test::__print_slowest() const {
+    if (_data->slowest == 0)
+        return;
+
+    std::vector<const Group*> groups;
+    for (const Group& group : _data->groups) {
+        if (group.stats.duration_ns > 0)
+            groups.push_back(&group);
+    }
+    std::vector<const CheckRecord*> checks;
+    for (const CheckRecord& record : _data->slowest_checks)
+        checks.push_back(&record);
+    const std::size_t nb_groups = std::min<std::size_t>(_data->slowest, groups.size());
+    const std::size_t nb_checks = std::min<std::size_t>(_data->slowest, checks.size());
+    std::partial_sort(groups.begin(), groups.begin() + nb_groups, groups.end(),
+                      [](const Group* a, const Group* b) {
+                          return a->stats.duration_ns > b->stats.duration_ns;
+                      });
+    std::partial_sort(checks.begin(), checks.begin() + nb_checks, checks.end(),
+                      [](const CheckRecord* a, const CheckRecord* b) {
+                          return a->duration_ns > b->duration_ns;
+                      });
+
+    std::cout << std::fixed << std::setprecision(3);
+    if (nb_groups > 0)
+        std::cout << "### SLOWEST GROUPS:\n";
+    for (std::size_t i = 0; i < nb_groups; ++i)
+        std::cout << " - (" << groups[i]->name << ") "
+                  << to_seconds(groups[i]->stats.duration_ns) * 1e3 << " ms\n";
+    if (nb_checks > 0)
+        std::cout << "### SLOWEST CHECKS:\n";
+    for (std::size_t i = 0; i < nb_checks; ++i) {
+        const CheckRecord& check = *checks[i];
+        const std::string_view group =
+          check.group >= 0 ? std::string_view(_data->groups[check.group].name) : "global";
+        std::cout << " - (" << group << ") " << check.description << ": "
+                  << to_seconds(check.duration_ns) * 1e3 << " ms\n";
+    }
+    std::cout << std::defaultfloat;
+}
+
+bool featurless::test::__write_report(const char* const format, const char* const path) const {
+    std::ofstream file{ path };
+    if (!file)
+        return false;
+    file << std::setprecision(9);
+
+    // failures of a group, global ones at index -1
+    std::vector<std::vector<const CheckRecord*>> records(_data->groups.size() + 1);
+    for (const CheckRecord& record : _data->records)
+        records[static_cast<std::size_t>(record.group + 1)].push_back(&record);
+
+    const Stats& global = _data->global_stats;
+    if (std::string_view(format) == "json") {
+        const auto write_checks = [&file](const std::vector<const CheckRecord*>& checks) {
+            file << "\"checks\": [";
+            for (std::size_t i = 0; i < checks.size(); ++i) {
+                file << (i > 0 ? ", " : "") << "{\"description\": "
+                     << json_escape(checks[i]->description)
+                     << ", \"success\": " << (checks[i]->success ? "true" : "false");
+                if (checks[i]->duration_ns >= 0)
+                    file << ", \"duration\": " << to_seconds(checks[i]->duration_ns);
+                file << '}';
+            }
+            file << ']';
+        };
+        file << "{\n  \"status\": \"" << status_name(global.status) << "\", \"successes\": "
+             << global.count_success << ", \"checked\": " << global.count_checks
+             << ", \"total\": " << global.count_total
+             << ", \"duration\": " << to_seconds(global.duration_ns)
+             << ",\n  \"shard\": {\"index\": " << _data->shard_index
+             << ", \"count\": " << _data->shard_count << "},\n  ";
+        write_checks(records[0]);
+        file << ",\n  \"groups\": [";
+        for (std::size_t i = 0; i < _data->groups.size(); ++i) {
+            const Group& group = _data->groups[i];
+            file << (i > 0 ? "," : "") << "\n    {\"name\": " << json_escape(group.name)
+                 << ", \"enabled\": " << (group.enabled ? "true" : "false") << ", \"status\": \""
+                 << status_name(group.stats.status) << "\", \"successes\": "
+                 << group.stats.count_success << ", \"checked\": " << group.stats.count_checks
+                 << ", \"duration\": " << to_seconds(group.stats.duration_ns) << ", ";
+            if (featurless::alloc_tracker::installed)
+                file << "\"allocations\": " << group.stats.alloc_count
+                     << ", \"allocated_bytes\": " << group.stats.alloc_bytes << ", ";
+            write_checks(records[i + 1]);
+            file << '}';
+        }
+        std::vector<const CheckRecord*> slowest;
+        for (const CheckRecord& record : _data->slowest_checks)
+            slowest.push_back(&record);
+        std::sort(slowest.begin(), slowest.end(), [](const CheckRecord* a, const CheckRecord* b) {
+            return a->duration_ns > b->duration_ns;
+        });
+        file << "\n  ],\n  \"slowest_checks\": [";
+        for (std::size_t i = 0; i < slowest.size(); ++i) {
+            file << (i > 0 ? "," : "") << "\n    {\"group\": "
+                 << (slowest[i]->group >= 0 ? json_escape(_data->groups[slowest[i]->group].name)
+                                            : std::string("null"))
+                 << ", \"description\": " << json_escape(slowest[i]->description)
+                 << ", \"duration\": " << to_seconds(slowest[i]->duration_ns) << '}';
+        }
+        file << "\n  ],\n  \"fixtures\": [";
+        for (std::size_t i = 0; i < _data->fixture_setups.size(); ++i) {
+            const auto& [index, setup_ns] = _data->fixture_setups[i];
+            file << (i > 0 ? "," : "") << "\n    {\"name\": "
+                 << json_escape(_data->fixtures[index].name)
+                 << ", \"setup\": " << to_seconds(setup_ns) << '}';
+        }
+        file << "\n  ],\n  \"benchmarks\": [";
+        for (std::size_t i = 0; i < _data->benchmarks.size(); ++i) {
+            const BenchResult& bench = _data->benchmarks[i];
+            file << (i > 0 ? "," : "") << "\n    {\"group\": " << json_escape(bench.group)
+                 << ", \"description\": " << json_escape(bench.description)
+                 << ", \"samples\": " << bench.samples << ", \"iterations\": " << bench.iterations
+                 << ", \"min_ns\": " << bench.min << ", \"median_ns\": " << bench.median
+                 << ", \"mean_ns\": " << bench.mean << ", \"stddev_ns\": " << bench.stddev
+                 << ", \"p99_ns\": " << bench.p99;
+            if (!std::isnan(bench.counters[0])) {
+                file << ", \"counters\": {";
+                for (std::size_t j = 0; j < nb_counters; ++j) {
+                    if (!std::isnan(bench.counters[j]))
+                        file << (j > 0 ? ", \"" : "\"") << counter_names[j]
+                             << "\": " << bench.counters[j];
+                }
+                if (!std::isnan(bench.counters[1]))
+                    file << ", \"ipc\": " << bench.counters[1] / bench.counters[0];
+                file << '}';
+            }
+            file << '}';
+        }
+        file << "\n  ]\n}\n";
+    } else {
+        // one testsuite per group: a testcase per failure, and one for all the
+        // successful checks, so that the counts match the testcases.
+        const auto nb_testcases = [](const Stats& stats,
+                                     const std::vector<const CheckRecord*>& failures) {
+            return failures.size() + (stats.count_success > 0 ? 1 : 0);
+        };
+        const auto write_suite = [&file, &nb_testcases](
+                                   const std::string_view name, const Stats& stats,
+                                   const std::vector<const CheckRecord*>& failures) {
+            file << "  <testsuite name=\"" << xml_escape(name) << "\" tests=\""
+                 << nb_testcases(stats, failures) << "\" failures=\"" << failures.size()
+                 << "\" time=\"" << to_seconds(stats.duration_ns) << "\">\n";
+            if (stats.count_success > 0)
+                file << "    <testcase classname=\"" << xml_escape(name) << "\" name=\""
+                     << stats.count_success << " successful checks\" time=\""
+                     << to_seconds(stats.duration_ns) << "\"/>\n";
+            for (const CheckRecord* check : failures) {
+                file << "    <testcase classname=\"" << xml_escape(name) << "\" name=\""
+                     << xml_escape(check->description) << "\" time=\""
+                     << to_seconds(std::max<int64_t>(check->duration_ns, 0))
+                     << "\">\n      <failure message=\"" << xml_escape(check->description)
+                     << "\"/>\n    </testcase>\n";
+            }
+            file << "  </testsuite>\n";
+        };
+        Stats global_only = global;
+        for (const Group& group : _data->groups) {
+            global_only.count_checks -= group.stats.count_checks;
+            global_only.count_success -= group.stats.count_success;
+        }
+        // global checks are only counted in the first shard, the merged
+        // reports have one global suite.
+        std::size_t nb_tests = 0;
+        std::size_t nb_failures = 0;
+        if (_data->global_enabled()) {
+            nb_tests += nb_testcases(global_only, records[0]);
+            nb_failures += records[0].size();
+        }
+        for (std::size_t i = 0; i < _data->groups.size(); ++i) {
+            if (_data->groups[i].enabled) {
+                nb_tests += nb_testcases(_data->groups[i].stats, records[i + 1]);
+                nb_failures += records[i + 1].size();
+            }
+        }
+        file << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<testsuites name=\"shard "
+             << _data->shard_index << " of " << _data->shard_count << "\" tests=\"" << nb_tests
+             << "\" failures=\"" << nb_failures << "\">\n";
+        if (_data->global_enabled())
+            write_suite("global", global_only, records[0]);
+        for (std::size_t i = 0; i < _data->groups.size(); ++i) {
+            if (_data->groups[i].enabled)
+                write_suite(_data->groups[i].name, _data->groups[i].stats, records[i + 1]);
+        }
+        file << "</testsuites>\n";
+    }
+    return static_cast<bool>(file);
 }
 
 static void print_group_summary(const std::string_view group,
                                 bool success,
-                                uint8_t nb_success,
-                                uint8_t nb_checks) {
+                                uint64_t nb_success,
+                                uint64_t nb_checks) {
     std::cout << " - (" << group << ") status: " << (success ? "OK" : "KO") << ", "
               << "successes: " << std::to_string(nb_success) << ", "
-              << "checked: " << std::to_string(nb_checks) << '\n';
+              << "checked: " << std::to_string(nb_checks);
 }
 
 void featurless::test::print_summary() const {
@@ -208,17 +2388,91 @@ void featurless::test::print_summary() const {
               << " - successes: " << std::to_string(_data->global_stats.count_success) << '\n'
               << " - checked: " << std::to_string(_data->global_stats.count_checks) << '\n'
               << " - total checks: " << std::to_string(_data->global_stats.count_total)
-              << " (counting unperformed ones)\n"
-              << "### GROUPS SUMMARY:\n";
+              << " (counting unperformed ones)\n";
+    if (_data->shard_count > 1)
+        std::cout << " - shard: " << _data->shard_index << " of " << _data->shard_count << '\n';
+    std::cout << "### GROUPS SUMMARY:\n";
+
+    for (const auto& group : _data->groups) {
+        // the groups of the other shards are listed by their own summary
+        if (_data->shard_count > 1 && !group.enabled)
+            continue;
+        print_group_summary(group.name, group.stats.status == StatusCode::ok,
+                            group.stats.count_success, group.stats.count_checks);
+        if (featurless::alloc_tracker::installed)
+            std::cout << ", allocations: " << group.stats.alloc_count << " ("
+                      << group.stats.alloc_bytes << " bytes)";
+        std::cout << '\n';
+    }
+
+    if (!_data->fixture_setups.empty()) {
+        std::cout << "### FIXTURES SETUP:\n" << std::fixed << std::setprecision(3);
+        for (const auto& [index, setup_ns] : _data->fixture_setups) {
+            std::cout << " - (" << _data->fixtures[index].name << ") "
+                      << to_seconds(setup_ns) * 1e3 << " ms\n";
+        }
+        std::cout << std::defaultfloat;
+    }
+    __print_slowest();
+    for (const auto& [format, path] : _data->reports) {
+        if (!__write_report(format.c_str(), path.c_str()))
+            std::cout << "Warning: could not write the " << format << " report '" << path << "'.\n";
+    }
+
+    if (!_data->stress_results.empty())
+        std::cout << "### STRESS SUMMARY:\n";
+    for (const auto& stress : _data->stress_results) {
+        uint64_t failures = 0;
+        std::string per_thread;
+        for (const uint64_t thread_failures : stress.failures) {
+            failures += thread_failures;
+            per_thread += (per_thread.empty() ? "" : ", ") + std::to_string(thread_failures);
+        }
+        const double iterations =
+          static_cast<double>(stress.iterations) * static_cast<double>(stress.failures.size());
+        std::cout << " - (" << stress.group << ") " << stress.description << ": "
+                  << stress.failures.size() << " threads x " << stress.iterations
+                  << " iterations, " << std::fixed << std::setprecision(0)
+                  << iterations / std::max(to_seconds(stress.duration_ns), 1e-9)
+                  << " iterations/s, failures " << failures << " (" << per_thread << ")\n"
+                  << std::defaultfloat;
+    }
 
-    for (const auto& group : _data->groups_stats) {
-        print_group_summary(group.first, group.second.status == StatusCode::ok,
-                            group.second.count_success, group.second.count_checks);
+    if (_data->benchmarks.empty())
+        return;
+    std::cout << "### BENCHMARKS SUMMARY (ns per iteration):\n"
+              << std::fixed << std::setprecision(2);
+    if (!_data->pmu_notice.empty())
+        std::cout << " - no hardware counters (" << _data->pmu_notice << "), time only\n";
+    for (const auto& bench : _data->benchmarks) {
+        std::cout << " - (" << bench.group << ") " << bench.description << ": min " << bench.min
+                  << ", median " << bench.median << ", mean " << bench.mean << ", stddev "
+                  << bench.stddev << ", p99 " << bench.p99 << " (" << bench.samples << " x "
+                  << bench.iterations << " iterations)\n";
+        if (std::isnan(bench.counters[0]))
+            continue;
+        std::cout << "   per iteration:";
+        for (std::size_t i = 0; i < nb_counters; ++i) {
+            if (!std::isnan(bench.counters[i]))
+                std::cout << (i > 0 ? ", " : " ") << counter_names[i] << ' ' << bench.counters[i];
+        }
+        if (!std::isnan(bench.counters[1]))
+            std::cout << ", ipc " << bench.counters[1] / bench.counters[0];
+        std::cout << '\n';
     }
+    std::cout << std::defaultfloat;
 }
 
 int featurless::test::status() const noexcept {
-    return _data->global_stats.status <= StatusCode::ok
-             ? 0
-             : static_cast<int>(_data->global_stats.status);
+    if (_data->global_stats.status > StatusCode::ok)
+        return static_cast<int>(_data->global_stats.status);
+    // an isolated group crashing or timing out fails the run, as it would
+    // have without --isolate
+    StatusCode status = StatusCode::ok;
+    for (const Group& group : _data->groups) {
+        if (group.stats.status == StatusCode::crashed
+            || (group.stats.status == StatusCode::timeout && status == StatusCode::ok))
+            status = group.stats.status;
+    }
+    return static_cast<int>(status);
 }
@@ -0,0 +1,89 @@
+#include <featurless/test.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <thread>
+
+// Runs groups crashing or hanging with --isolate, then checks the status of
+// each group in the json report and the status of the run.
+
+static int run_isolated(const char* const program, const std::string& report, bool with_crash)
+{
+    const std::string report_arg = "--report=json:" + report;
+    const char* argv[]{ program, "--isolate", "-j", "3", "--timeout", "1", report_arg.c_str() };
+    featurless::test tester;
+    tester.parse_args(7, argv);
+    if (with_crash)
+        tester.add_group("aborts", [](featurless::test&) { std::abort(); });
+    tester.add_group("hangs", [](featurless::test&)
+    {
+        std::this_thread::sleep_for(std::chrono::seconds(30));
+    });
+    tester.add_group("passes", [](featurless::test& tester)
+    {
+        tester.check("passes", "success", true);
+    });
+    tester.run();
+    tester.print_summary();
+    return tester.status();
+}
+
+// status of a group in a json report, empty if not found
+static std::string group_status(const std::string& report, const std::string& group)
+{
+    std::ifstream file{ report };
+    const std::string json{ std::istreambuf_iterator<char>(file),
+                            std::istreambuf_iterator<char>() };
+    const std::size_t name = json.find("{\"name\": \"" + group + '"');
+    const std::string key = "\"status\": \"";
+    const std::size_t status = json.find(key, name);
+    if (name == std::string::npos || status == std::string::npos)
+        return {};
+    const std::size_t begin = status + key.size();
+    return json.substr(begin, json.find('"', begin) - begin);
+}
+
+int main(int argc, const char** argv)
+{
+    featurless::test tester;
+    tester.parse_args(argc, argv);
+    tester.add_group("isolate");
+
+#if defined(__unix__) || defined(__APPLE__)
+    const std::string report = std::string(argv[0]) + ".isolate.json";
+
+    const int crashed = run_isolated(argv[0], report, true);
+    tester.check("isolate", "a crash fails the run with 3", crashed == 3);
+    tester.check("isolate", "the aborting group crashed",
+                 group_status(report, "aborts") == "crashed");
+    tester.check("isolate", "the hanging group timed out",
+                 group_status(report, "hangs") == "timeout");
+    tester.check("isolate", "the other group passed", group_status(report, "passes") == "ok");
+
+    const int timed_out = run_isolated(argv[0], report, false);
+    tester.check("isolate", "a timeout fails the run with 4", timed_out == 4);
+    tester.check("isolate", "the hanging group timed out again",
+                 group_status(report, "hangs") == "timeout");
+    std::remove(report.c_str());
+#endif
+
+    tester.print_summary();
+    return tester.status();
+}
+
+// Expected (POSIX, about 2s):
+// - the summaries of the two isolated runs, with the failures "(aborts) crashed
+//   with signal 6" and "(hangs) timed out after 1s".
+// Total 6 checks
+// group isolate  (6/6)
+//  - check status 3        1/1
+//  - check crashed         2/2
+//  - check timeout         3/3
+//  - check ok              4/4
+//  - check status 4        5/5
+//  - check timeout         6/6
+// exit code 0
@@ -1,3 +1,4 @@
+#include <featurless/property.h>
 #include <featurless/test.h>
 
 bool truefun()
@@ -5,6 +6,71 @@ bool truefun()
     return true;
 }
 
+void groupD(featurless::test& tester)
+{
+    tester.check("groupD", "success", true);
+    tester.check("groupD", "failure group D", false);
+    tester.require("groupD", "total failure group D", false);
+}
+
+void groupDNeverReached(featurless::test& tester)
+{
+    tester.check("groupD", "success never reached", true);
+}
+
+void groupE(featurless::test& tester)
+{
+    tester.check("groupE", "success", truefun);
+    tester.check("groupE", "success again", true);
+
+    namespace gen = featurless::gen;
+    tester.check_property("groupE", "division round trip", gen::integer<int>(-1000, 1000),
+                          gen::integer<int>(1, 1000),
+                          [](int a, int b) { return a / b * b + a % b == a; });
+
+    // unsigned: the benchmarks add to it millions of times, it wraps around
+    unsigned sum = 0;
+    tester.bench("groupE", "sum of ints", [&sum]()
+    {
+        for (unsigned i = 0; i < 64; ++i)
+            sum += i;
+        featurless::test::do_not_optimize(sum);
+    });
+    tester.check_perf("groupE", "sum of ints within 50% of its baseline", [&sum]()
+    {
+        for (unsigned i = 0; i < 64; ++i)
+            sum += i;
+        featurless::test::do_not_optimize(sum);
+    }, 0.5);
+
+    tester.require_no_alloc("groupE", "sum of ints without allocation", [&sum]() { sum += 1; });
+    tester.check_alloc("groupE", "one int allocated", []()
+    {
+        int* value = new int(1);
+        featurless::test::do_not_optimize(value);
+        delete value;
+    }, 1, sizeof(int));
+
+    tester.stress("groupE", "checks from 4 threads at once", 4, 10,
+                  [&tester](unsigned thread, unsigned long long)
+    {
+        tester.check("groupE", "checked by a stress thread", thread < 4);
+        return true;
+    }, featurless::test::stress_yield);
+}
+
+FEATURLESS_TEST("groupF", "registered before main")
+{
+    tester.check("groupF", "success", true);
+}
+
+FEATURLESS_TEST("groupF", "registered before main, evaluated after the previous one")
+{
+    tester.check("groupF", "success again", truefun);
+    const int* answer = tester.fixture<int>("answer");
+    tester.check("groupF", "fixture built on first use", answer != nullptr && *answer == 42);
+}
+
 int main(int argc, const char** argv)
 {
     featurless::test tester;
@@ -18,10 +84,22 @@ int main(int argc, const char** argv)
     tester.add_group("groupA");
     tester.add_group("groupB");
     tester.add_group("groupC");
+    tester.add_group("groupD", groupD);
+    tester.add_group("groupD", groupDNeverReached);
+    tester.add_group("groupE", groupE);
+    tester.set_timeout("groupE", 30);
+    tester.add_fixture<int>("answer", []() { return new int(42); });
+    tester.add_fixture<int>("never built, no group uses it", []() { return new int(0); });
 
     tester.check("mygroupwhichdoesnotexist", "I must not appear my group does not exist.", true);
 
     tester.check("group0", "success", true);
+    int nb_calls = 0;
+    tester.check("group0", "capturing lambda", [&nb_calls]() { return ++nb_calls == 1; });
+    tester.check_eq("group0", "comparison", 2 + 2, 4);
+    tester.check_near("group0", "comparison within a tolerance", 0.1 + 0.2, 0.3, 1e-9);
+    const char copy[]{ "abc" };
+    tester.check_eq("group0", "C strings compared by content", copy, "abc");
 
     tester.check("groupA", "success", true);
     tester.check("groupA", "failure group A", false);
@@ -31,10 +109,17 @@ int main(int argc, const char** argv)
 
     tester.check("groupB", "success", true);
     tester.check("groupB", "failure group B", false);
+    tester.check_eq("groupB", "comparison failure group B, prints 2 == 3", 1 + 1, 3);
     tester.check("groupB", "success again", truefun);
     tester.require("groupB", "total failure group B", falsefun);
     tester.check("groupB", "success never reached", true);
 
+    tester.run();
+
+    const auto groupG = tester.add_group("groupG");
+    for (int i = 0; i < 1000; ++i)
+        tester.check(groupG, "more checks than a byte can count", i >= 0);
+
     tester.check("success", true);
     tester.check("failure global", false);
     tester.check("success again", truefun);
@@ -46,37 +131,63 @@ int main(int argc, const char** argv)
     tester.check("groupC", "success again", truefun);
     tester.require("groupC", "total failure group C", falsefun);
     tester.check("groupC", "success never reached", true);
+    tester.bench("groupC", "never benchmarked, global require failed", []() {});
 
     tester.print_summary();
     return tester.status();
 }
 
 // Expected:
-// Total 22 checks
+// Total 1080 checks (groupDNeverReached is not run)
 // - check unkown group 0/0
-// group 0  (1/1)
+// group 0  (5/5)
 //  - check success 1/1     1/1
+//  - check lambda 2/2      2/2
+//  - check eq 3/3          3/3
+//  - check near 4/4        4/4
+//  - check eq 5/5          5/5
 // group A  (2/4)
-//  - check success 1/1     2/2
-//  - check failure 1/2     2/3
-//  - check success 2/3     3/4
-//  - require failure 2/4   3/5
-//  - check success 2/4     3/5
-// group B  (2/4)
-//  - check success 1/1     4/6
-//  - check failure 1/2     4/7
-//  - check success 2/3     5/8
-//  - require failure 2/4   5/9
-//  - check success 2/4     5/9
-// global   (6/12)
-//  - check success NA      6/10
-//  - check failure NA      6/11
-//  - check success NA      7/12
-//  - require failure NA    7/13
-//  - check success NA      7/13
+//  - check success 1/1     6/6
+//  - check failure 1/2     6/7
+//  - check success 2/3     7/8
+//  - require failure 2/4   7/9
+//  - check success 2/4     7/9
+// group B  (2/5)
+//  - check success 1/1     8/10
+//  - check failure 1/2     8/11
+//  - check eq failure 1/3  8/12
+//  - check success 2/4     9/13
+//  - require failure 2/5   9/14
+//  - check success 2/5     9/14
+// group D  (1/3), run by tester.run()
+//  - check success 1/1     10/15
+//  - check failure 1/2     10/16
+//  - require failure 1/3   10/17
+//  - groupDNeverReached not run
+// group E  (47/47), run by tester.run()
+//  - check success 1/1     11/18
+//  - check success 2/2     12/19
+//  - check property 3/3    13/20 (division round trip)
+//  - check perf 4/4        14/21 (no baseline: success)
+//  - require no alloc 5/5  15/22
+//  - check alloc 6/6       16/23
+//  - check x40 46/46       56/63 (stress threads)
+//  - stress 47/47          57/64
+// group F  (3/3), FEATURLESS_TEST run by tester.run()
+//  - check success 1/1     58/65
+//  - check success 2/2     59/66
+//  - check fixture 3/3     60/67
+// group G  (1000/1000), checked with a handle
+//  - check success x1000   1060/1067
+// global   (1062/1071)
+//  - check success NA      1061/1068
+//  - check failure NA      1061/1069
+//  - check success NA      1062/1070
+//  - require failure NA    1062/1071
+//  - check success NA      1062/1071
 // group C (0/0)
-//  - check success NA      7/13
-//  - check failure NA      7/13
-//  - check success NA      7/13
-//  - require failure NA    7/13
-//  - check success NA      7/13
+//  - check success NA      1062/1071
+//  - check failure NA      1062/1071
+//  - check success NA      1062/1071
+//  - require failure NA    1062/1071
+//  - check success NA      1062/1071